@@ -19,10 +19,12 @@ static void decorate(void);
  * @brief      Test for vsync callback.
  */
 static void speckleTest(void) {
-    uint8_t *vRAM = DVIGetModeInformation()->bitPlane[0];
+    DVIMODEINFO *dmi = DVIGetModeInformation();
+    uint8_t *vRAM = dmi->bitPlane[0];
     for (int i = 0;i < 100;i++) {
         vRAM[random() % (320*10)+320*10] = random();
     }
+    DVIMarkDirty(320*10/dmi->bytesPerLine,320*20/dmi->bytesPerLine);
 }
 
 int MAINPROGRAM(int argc,char *argv[]) {
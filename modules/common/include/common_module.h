@@ -39,6 +39,35 @@ bool COMAppRunning(void);
 void COMAddUpdateFunction(COMUPDATEFUNCTION updateFunc);
 void COMUpdate(void);
 
+//
+//      Profiling. This is only done in the runtime, built with PROFILE ; otherwise PROFILE_BEGIN/END do nothing
+//      and COMProfileGet() returns false. Times are inclusive, in nanoseconds.
+//
+#define PROFILE_UPDATE  (0)                                                         // Update functions, in order registered
+#define PROFILE_YIELD   (8)                                                         // SYSYield, in the PROFILE_UPDATE group
+#define PROFILE_VDU     (1)                                                         // VDU commands 0-31 and 127, 32 is text
+#define PROFILE_PLOT    (2)                                                         // PLOT classes, command >> 3
+#define PROFILE_GROUPS  (3)
+#define PROFILE_ENTRIES (128)
+
+typedef struct _comProfile {
+    uint32_t calls;                                                                 // Times called
+    uint64_t totalTime,maxTime;                                                     // Total and longest time, in ns
+} COMPROFILE;
+
+bool COMProfileGet(int group,int index,COMPROFILE *result);
+void COMProfileReset(void);
+
+#if defined(RUNTIME) && defined(PROFILE)
+uint64_t COMProfileClock(void);
+void COMProfileRecord(int group,int index,uint64_t startTime);
+#define PROFILE_BEGIN()     uint64_t _profileStart = COMProfileClock()
+#define PROFILE_END(g,i)    COMProfileRecord((g),(i),_profileStart)
+#else
+#define PROFILE_BEGIN()     {}
+#define PROFILE_END(g,i)    {}
+#endif
+
 #ifdef RUNTIME
 bool SYSYield(void);
 #define MAINPROGRAM MainApplication
@@ -109,4 +109,24 @@ void COMUpdate(void) {
 uint32_t COMGetFreeSystemMemory(void) {
    extern char __StackLimit, __bss_end__;   
    return &__StackLimit  - &__bss_end__;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief      Get profiling information. Profiling is only available in the
+ *             runtime.
+ *
+ * @param[in]  group   Group (PROFILE_xxx)
+ * @param[in]  index   Entry in the group
+ * @param      result  Where the information goes
+ *
+ * @return     false, as there is no profiling information.
+ */
+bool COMProfileGet(int group,int index,COMPROFILE *result) {
+    return false;
+}
+
+/**
+ * @brief      Reset profiling information, which does nothing here.
+ */
+void COMProfileReset(void) {
+}
@@ -31,8 +31,46 @@ typedef struct _DVIModeInformation {
     uint32_t bytesPerLine;                                                          // Bytes per line of display.
     uint8_t *bitPlane[DVI_MAX_BITPLANES];                                           // Up to 8 bitplanes    
     uint32_t bitPlaneSize;                                                          // Byte size of each bitplane.
+    bool isChunky;                                                                  // One plane of packed pixels, bitPlaneDepth bits each, through the palette.
+    uint32_t yOffset;                                                               // Plane line shown at the top of the display, lines wrap round.
+    uint32_t pageCount;                                                             // Pages that fit in framebuf, each of bitPlaneCount planes.
+    uint32_t drawPage;                                                              // Page bitPlane[] points to.
+    uint32_t displayPage;                                                           // Page shown, from the next frame.
+    uint32_t cellHeight;                                                            // Text modes, lines in a character cell, 0 otherwise.
 } DVIMODEINFO;
 
+/**
+ * @brief      Get the offset of a plane line from the start of the plane. In
+ *             the text modes a line is in a row of cells, bytesPerLine being
+ *             the size of a row.
+ *
+ * @param      dm    Mode information
+ * @param[in]  line  Plane line, after the scroll offset.
+ *
+ * @return     Byte offset in the plane.
+ */
+static inline uint32_t DVIGetLineOffset(DVIMODEINFO *dm,uint32_t line) {
+    if (dm->cellHeight != 0) line /= dm->cellHeight;
+    return line * dm->bytesPerLine;
+}
+
+/**
+ * @brief      Get the address of a display line in a plane, allowing for the
+ *             vertical scroll offset. Lines after the end of the plane wrap
+ *             round to the start.
+ *
+ * @param      dm     Mode information
+ * @param[in]  plane  Bitplane
+ * @param[in]  y      Display line, 0 is the top
+ *
+ * @return     Address of the first byte of the line.
+ */
+static inline uint8_t *DVIGetLineAddress(DVIMODEINFO *dm,int plane,int y) {
+    uint32_t line = y + dm->yOffset;
+    if (line >= dm->height) line -= dm->height;
+    return dm->bitPlane[plane] + DVIGetLineOffset(dm,line);
+}
+
 //
 //      Structure for mode information.
 //
@@ -41,10 +79,151 @@ typedef enum _DVIMode {
     MODE_320_240_8 = 1,
     MODE_320_240_64 = 2,
     MODE_320_256_8 = 3,
-    MODE_640_480_8 = 4
+    MODE_640_480_8 = 4,
+    MODE_320_240_16 = 5,
+    MODE_320_240_256 = 6,
+    MODE_TEXT_80_30 = 7,
+    MODE_TEXT_40_30 = 8
 } DVIMODE;
 
-#define DVI_MODE_COUNT      (5)                                                     // Supported DVI modes.
+#define DVI_MODE_COUNT      (9)                                                     // Supported DVI modes.
+#define DVI_PALETTE_SIZE    (256)                                                   // Palette entries for the chunky modes.
+
+//
+//      Line repeat descriptors. Each of the 480 output lines shows one source line of the framebuffer. When an
+//      output line shows the same source line as the one before it, the scanout reuses the TMDS encoded line
+//      rather than encoding it again.
+//
+typedef struct _DVILineRepeat {
+    uint8_t repeat;                                                                 // Output lines for each source line.
+    uint8_t group;                                                                  // If non zero, the last line of each group of this many is shown once.
+} DVILINEREPEAT;
+
+/**
+ * @brief      Get the source line shown on an output line.
+ *
+ * @param[in]  lr    Line repeat descriptor
+ * @param[in]  y     Output line, 0-479
+ *
+ * @return     Source line in the framebuffer.
+ */
+static inline int DVIGetSourceLine(DVILINEREPEAT lr,int y) {
+    if (lr.group == 0) return y / lr.repeat;
+    return (y / lr.group) * ((lr.group + lr.repeat - 1) / lr.repeat) + (y % lr.group) / lr.repeat;
+}
+
+/**
+ * @brief      Does an output line show the same source line as the one before
+ *             it, so it can reuse its TMDS encoding ? The first line of the
+ *             frame is always encoded.
+ *
+ * @param[in]  lr    Line repeat descriptor
+ * @param[in]  y     Output line, 0-479
+ *
+ * @return     true if the line before can be reused.
+ */
+static inline bool DVIIsRepeatedLine(DVILINEREPEAT lr,int y) {
+    return y != 0 && DVIGetSourceLine(lr,y) == DVIGetSourceLine(lr,y-1);
+}
+
+//
+//      Mode descriptors. Each mode is a row in a table in config.c, so adding a mode means adding a DVIMODE and
+//      a row. The encoder says how core 1 turns a line of the planes into TMDS symbols.
+//
+typedef enum _DVIEncoder {
+    DVI_ENCODE_1BPP = 0,                                                            // 3 planes, 1 bit per pixel, 640 pixels.
+    DVI_ENCODE_1BPP_DOUBLE = 1,                                                     // 3 planes, 1 bit per pixel, 320 pixels each shown twice.
+    DVI_ENCODE_2BPP = 2,                                                            // 3 planes, 2 bits per pixel, 320 pixels.
+    DVI_ENCODE_PALETTE_4BPP = 3,                                                    // 1 plane, 4 bits per pixel through the palette.
+    DVI_ENCODE_PALETTE_8BPP = 4,                                                    // 1 plane, 8 bits per pixel through the palette.
+    DVI_ENCODE_TEXT = 5,                                                            // Character cells, 80 columns.
+    DVI_ENCODE_TEXT_DOUBLE = 6                                                      // Character cells, 40 columns each pixel shown twice.
+} DVIENCODER;
+
+#define DVI_ENCODER_COUNT   (7)
+
+typedef struct _DVIModeDescriptor {
+    uint16_t width,height;                                                          // Size in pixels.
+    uint8_t bitPlaneCount;                                                          // Number of planes.
+    uint8_t bitPlaneDepth;                                                          // Bits per pixel in each plane.
+    bool isChunky;                                                                  // One plane of packed pixels.
+    DVIENCODER encoder;                                                             // How it is encoded.
+    DVILINEREPEAT lineRepeat;                                                       // How output lines map onto its lines.
+    uint8_t cellHeight;                                                             // Text modes, font height, 0 otherwise.
+} DVIMODEDESCRIPTOR;
+
+const DVIMODEDESCRIPTOR *DVIGetModeDescriptor(int mode);
+DVILINEREPEAT DVIGetLineRepeat(int mode);
+void DVIBuildLineMap(DVILINEREPEAT lr,uint16_t *lineMap);
+
+//
+//      Text modes. The single plane is rows of 16 bit character cells, 8 pixels wide and cellHeight lines high,
+//      which the scanout draws through the system font. The low byte is the character, bits 8-10 the
+//      foreground and bits 12-14 the background, both BGR colours as the 8 colour modes. The scroll offset and
+//      raster list are still in lines, so a text display can scroll smoothly.
+//
+#define DVI_CELL(c,fg,bg)   ((uint16_t)(((c) & 0xFF) | (((fg) & 7) << 8) | (((bg) & 7) << 12)))
+#define DVI_CELL_CHAR(cell) ((cell) & 0xFF)
+#define DVI_CELL_FG(cell)   (((cell) >> 8) & 7)
+#define DVI_CELL_BG(cell)   (((cell) >> 12) & 7)
+
+/**
+ * @brief      Get the address of a character cell, allowing for the vertical
+ *             scroll offset.
+ *
+ * @param      dm    Mode information, of a text mode
+ * @param[in]  x     Column
+ * @param[in]  y     Row, 0 is the top
+ *
+ * @return     Address of the cell.
+ */
+static inline uint16_t *DVIGetCellAddress(DVIMODEINFO *dm,int x,int y) {
+    return (uint16_t *)DVIGetLineAddress(dm,0,y * dm->cellHeight) + x;
+}
+
+//
+//      Raster list. Each entry changes the scanout from a display line (0 is the top, in the mode's lines) to
+//      the end of the frame, so the display can be split without copying. Entries must be in line order ;
+//      the scanout starts each frame with the scroll offset and palette that were set normally.
+//
+typedef enum _DVIRasterAction {
+    DVI_RASTER_OFFSET = 0,                                                          // Scroll offset is value from this line.
+    DVI_RASTER_PALETTE = 1                                                          // Palette entry (value >> 24) is value & 0xFFFFFF.
+} DVIRASTERACTION;
+
+typedef struct _DVIRasterEntry {
+    uint16_t line;                                                                  // Display line it takes effect on.
+    uint8_t action;                                                                 // One of DVIRASTERACTION
+    uint32_t value;                                                                 // What it is set to.
+} DVIRASTERENTRY;
+
+#define DVI_MAX_RASTER      (32)                                                    // Most entries in the raster list.
+
+//
+//      Sprites. Core 1 draws them over the display as it builds each line, so moving one is changing its
+//      position, the framebuffer is not touched. Images are one 32 bit word a row, the leftmost pixel in bit 31 ;
+//      3 bit images are three of these one after the other, red green then blue, and the pixel is a colour 0-7.
+//      1 bit images are drawn in the sprite's colour, and 0 where the mask is set but the image is not. The mask
+//      is the same layout, set where the sprite is drawn ; if NULL it is drawn where the pixel is not 0.
+//      Positions are in pixels and display lines, so sprites do not move with the scroll offset. Sprite 0 is
+//      drawn first, so higher numbered sprites are in front. The mouse pointer is one more entry in the table,
+//      drawn last, a 16x16 1 bit image in white and black.
+//
+#define DVI_MAX_SPRITES     (16)                                                    // Number of sprites.
+#define DVI_SPRITE_SIZE     (32)                                                    // Largest width and height.
+#define DVI_POINTER_SPRITE  (DVI_MAX_SPRITES)                                       // The mouse pointer, in front of the sprites.
+#define DVI_SPRITE_ENTRIES  (DVI_MAX_SPRITES+1)                                     // Entries in the sprite table, with the pointer.
+#define DVI_POINTER_SIZE    (16)                                                    // Pointer images are 16x16.
+
+typedef struct _DVISprite {
+    int16_t x,y;                                                                    // Top left, may be partly off the display.
+    uint8_t width,height;                                                           // Size, 1 to DVI_SPRITE_SIZE
+    uint8_t depth;                                                                  // Bits per pixel, 1 or 3.
+    uint8_t colour;                                                                 // Colour of 1 bit images, in the mode's colours.
+    bool isVisible;                                                                 // Drawn if set.
+    const uint32_t *image;                                                          // Image, which must stay where it is.
+    const uint32_t *mask;                                                           // Mask, or NULL.
+} DVISPRITE;
 
 void DVIInitialise(void);
 bool DVISetMode(DVIMODE mode);
@@ -52,6 +231,47 @@ DVIMODEINFO *DVIGetModeInformation(void);
 uint32_t  DVIGetScreenExtent(uint32_t *pWidth,uint32_t *pHeight);
 uint8_t *DVIGetSystemFont(void);
 uint8_t *DVIGetSystemFont16(void);
+const uint8_t *DVIGetTextFont(void);
+void DVISetPalette(int colour,uint32_t rgb);
+uint32_t DVIGetPalette(int colour);
+uint32_t DVIGetDefaultPalette(int colour);
+void DVIResetPalette(void);
+void DVISetScrollOffset(int yOffset);
+bool DVISetDisplayPage(int page);
+bool DVISetDrawPage(int page);
+bool DVISetRasterList(const DVIRASTERENTRY *list,int count);
+int DVIGetRasterList(DVIRASTERENTRY *list);
+bool DVISetSprite(int n,const DVISPRITE *sprite);
+bool DVIMoveSprite(int n,int x,int y);
+bool DVIGetSprite(int n,DVISPRITE *sprite);
+void DVIRemoveSprites(void);
+void DVISetPointer(const uint32_t *image,const uint32_t *mask,int xHot,int yHot);
+void DVIShowPointer(bool isVisible);
+void DVIMovePointer(int x,int y);
+void DVIPointerModeChanged(int oldWidth,int oldHeight);
+
+//
+//      Vertical sync. The frame count goes up each time the scanout passes the last line of the display. The
+//      callback is called on core 0, from COMUpdate(), with the frame count ; if core 0 is busy for more than
+//      a frame it is only called once.
+//
+typedef void (*DVIVSYNCFUNCTION)(uint32_t frameCount);
+
+uint32_t DVIGetFrameCount(void);
+void DVIWaitVSync(void);
+void DVISetVSyncCallback(DVIVSYNCFUNCTION callback);
+
+//
+//      Changed line tracking. Lines are display lines, 0 is the top. The runtime uses this to only convert
+//      lines that have been drawn on ; the hardware scans out everything every frame so these do nothing.
+//
+#ifdef RUNTIME
+void DVIMarkDirty(int yFrom,int yTo);
+void DVIMarkAllDirty(void);
+#else
+#define DVIMarkDirty(yFrom,yTo) {}
+#define DVIMarkAllDirty() {}
+#endif
 
 #define FRAME_WIDTH 640                                                             // Not the *pixels*, it's the display setting.
 #define FRAME_HEIGHT 480
@@ -59,3 +279,18 @@ uint8_t *DVIGetSystemFont16(void);
 #define VIDEO_BYTES (PLANE_SIZE(FRAME_WIDTH,FRAME_HEIGHT) * 3)
 
 extern uint8_t framebuf[VIDEO_BYTES];
+extern volatile uint32_t dvi_frameCount;                                            // Frames scanned out, use DVIGetFrameCount()
+
+/**
+ * @brief      Get the address of a display page, the first byte of its first
+ *             plane. Pages that do not exist in the mode are page 0.
+ *
+ * @param      dm    Mode information
+ * @param[in]  page  Page number
+ *
+ * @return     Address of the page.
+ */
+static inline uint8_t *DVIGetPageAddress(DVIMODEINFO *dm,uint32_t page) {
+    if (page >= dm->pageCount) page = 0;
+    return framebuf + page * dm->bitPlaneSize * dm->bitPlaneCount;
+}
@@ -23,6 +23,7 @@
 #include "dvi_serialiser.h"
 #include "common_dvi_pin_configs.h"
 #include "tmds_encode_custom.h"
+#include "tmds_encode_reference.h"
 
 //
 //      PicoDVI Configuration
@@ -31,6 +32,14 @@
 #define DVI_TIMING dvi_timing_640x480p_60hz
 
 extern DVIMODEINFO dvi_modeInfo; 
+extern uint32_t dvi_paletteSymbols[3][DVI_PALETTE_SIZE];
+extern DVIRASTERENTRY dvi_rasterList[DVI_MAX_RASTER];
+extern uint32_t dvi_rasterSymbols[DVI_MAX_RASTER][3];
+extern volatile int dvi_rasterCount;
+extern const DVIMODEDESCRIPTOR *dvi_modeDescriptor;
+extern uint16_t dvi_lineMap[FRAME_HEIGHT];
+extern uint8_t dvi_textFont[256*16];
+extern DVISPRITE dvi_sprites[DVI_SPRITE_ENTRIES];
 
 extern struct dvi_inst dvi0;
 
@@ -0,0 +1,33 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :       tmds_buffers.h
+//      Purpose :    TMDS buffer scheduling for repeated lines
+//      Date :       17th October 2026
+//      Author :     Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+//
+//      PicoDVI passes TMDS buffers to its DMA interrupt on a valid queue, and the interrupt passes each one
+//      back on a free queue after it has been scanned out. Core 1 queues a buffer once for each output
+//      line it is shown on, so it gets one back for each of those. The free queue is made this size by
+//      dvi_init(), and the interrupt panics if it is full, so no more than this many can be out at once.
+//
+#define DVI_TMDS_FREE_QUEUE_SIZE    (8)
+
+void DVIResetTMDSBuffers(void);
+uint32_t *DVIGetTMDSBuffer(void);
+void DVIQueueTMDSBuffer(uint32_t *buffer);
+//
+//      The queues themselves. These are dvi0's queues in the driver, the runtime's scanout model has its
+//      own with a model of the interrupt. DVITakeReturnedBuffer() returns NULL if there are none and it is
+//      not told to wait.
+//
+uint32_t *DVITakeReturnedBuffer(bool wait);
+void DVISendBuffer(uint32_t *buffer);
@@ -0,0 +1,42 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :       tmds_encode_reference.h
+//      Purpose :    Portable C TMDS encoders
+//      Date :       17th October 2026
+//      Author :     Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+//
+//      Bit order of the framebuffer. This follows PicoDVI's default, the modules all build with it set to 1
+//      (leftmost pixel in bit 7).
+//
+#ifndef DVI_1BPP_BIT_REVERSE
+#define DVI_1BPP_BIT_REVERSE    (0)
+#endif
+//
+//      These produce exactly the same symbols as tmds_encode_custom_1bpp() and tmds_encode_custom_2bpp()
+//      in tmds_encode_custom.S, which only exist for the RP2350. Each output word is two 10 bit symbols,
+//      n_pix is the number of output pixels, and like the assembler they work in blocks of 32 pixels.
+//
+void tmds_encode_reference_1bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix);
+void tmds_encode_reference_2bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix);
+//
+//      Palette encoders for the chunky modes. Each input pixel is one output word, the pixel's entry in a
+//      table of symbol pairs for one colour component, built with tmds_encode_balanced_pair(). 4bpp pixels
+//      have the leftmost pixel in the upper 4 bits.
+//
+void tmds_encode_palette_4bpp(const uint8_t *pixbuf, uint32_t *symbuf, size_t n_pix, const uint32_t *palette);
+void tmds_encode_palette_8bpp(const uint8_t *pixbuf, uint32_t *symbuf, size_t n_pix, const uint32_t *palette);
+//
+//      The DVI specification encoder, and the pair of symbols for a level that leaves the running
+//      disparity where it started.
+//
+int tmds_encode_symbol(uint8_t d, int *balance);
+uint32_t tmds_encode_balanced_pair(uint8_t level);
@@ -10,9 +10,13 @@
 // *******************************************************************************************
 
 #include "dvi_module.h"
+#include "tmds_encode_reference.h"
 
 DVIMODEINFO dvi_modeInfo;                                                           // Mode information structure.
 
+static uint32_t dvi_palette[DVI_PALETTE_SIZE];                                      // Chunky mode palette, 0xRRGGBB
+uint32_t dvi_paletteSymbols[3][DVI_PALETTE_SIZE];                                   // TMDS symbol pairs for it, blue green red.
+
 /**
  * @brief      Get mode information
  *
@@ -22,72 +26,235 @@ DVIMODEINFO *DVIGetModeInformation(void) {
     return &dvi_modeInfo;
 }
 
+//
+//      Mode descriptors, indexed by DVIMODE.
+//
+static const DVIMODEDESCRIPTOR _modeTable[DVI_MODE_COUNT] = {
+    //  Width Height Planes Depth Chunky  Encoder                   Line repeat  Cell
+    {   640,  240,   3,     1,    false,  DVI_ENCODE_1BPP,          { 2,0 },     0 },   // MODE_640_240_8
+    {   320,  240,   3,     1,    false,  DVI_ENCODE_1BPP_DOUBLE,   { 2,0 },     0 },   // MODE_320_240_8
+    {   320,  240,   3,     2,    false,  DVI_ENCODE_2BPP,          { 2,0 },     0 },   // MODE_320_240_64
+    {   320,  256,   3,     1,    false,  DVI_ENCODE_1BPP_DOUBLE,   { 2,15 },    0 },   // MODE_320_256_8, 7 doubled, 1 single in each 15
+    {   640,  480,   3,     1,    false,  DVI_ENCODE_1BPP,          { 1,0 },     0 },   // MODE_640_480_8
+    {   320,  240,   1,     4,    true,   DVI_ENCODE_PALETTE_4BPP,  { 2,0 },     0 },   // MODE_320_240_16
+    {   320,  240,   1,     8,    true,   DVI_ENCODE_PALETTE_8BPP,  { 2,0 },     0 },   // MODE_320_240_256
+    {   640,  480,   1,     16,   false,  DVI_ENCODE_TEXT,          { 1,0 },     16 },  // MODE_TEXT_80_30, 16 bit cells, 8x16 font
+    {   320,  240,   1,     16,   false,  DVI_ENCODE_TEXT_DOUBLE,   { 2,0 },     8 }    // MODE_TEXT_40_30, 16 bit cells, 8x8 font
+};
+
+const DVIMODEDESCRIPTOR *dvi_modeDescriptor = NULL;                                 // Current mode's descriptor, NULL if none.
+uint16_t dvi_lineMap[FRAME_HEIGHT];                                                 // Source line for each output line.
+uint8_t dvi_textFont[256*16];                                                       // Text mode font, cellHeight bytes a character.
+
 /**
- * @brief      Set current mode
+ * @brief      Get the descriptor for a mode.
+ *
+ * @param[in]  mode  Display mode
+ *
+ * @return     Descriptor, or NULL if it is not a mode.
+ */
+const DVIMODEDESCRIPTOR *DVIGetModeDescriptor(int mode) {
+    if (mode < 0 || mode >= DVI_MODE_COUNT) return NULL;
+    return &_modeTable[mode];
+}
+
+/**
+ * @brief      Get the line repeat descriptor for a mode.
+ *
+ * @param[in]  mode  Display mode
+ *
+ * @return     Line repeat descriptor, all doubled if it is not a mode.
+ */
+DVILINEREPEAT DVIGetLineRepeat(int mode) {
+    const DVIMODEDESCRIPTOR *md = DVIGetModeDescriptor(mode);
+    return (md != NULL) ? md->lineRepeat : (DVILINEREPEAT) { 2,0 };
+}
+
+/**
+ * @brief      Work out the source line for every output line, so the scanout
+ *             only has to look it up.
+ *
+ * @param[in]  lr       Line repeat descriptor
+ * @param      lineMap  Table of FRAME_HEIGHT lines to fill in.
+ */
+void DVIBuildLineMap(DVILINEREPEAT lr,uint16_t *lineMap) {
+    for (int y = 0;y < FRAME_HEIGHT;y++) lineMap[y] = DVIGetSourceLine(lr,y);
+}
+
+/**
+ * @brief      Copy the system font for a text mode into RAM, all 256
+ *             characters, so the scanout does not have to read flash or check
+ *             for control characters, which are blank.
+ *
+ * @param[in]  cellHeight  8 or 16
+ */
+static void _DVILoadTextFont(int cellHeight) {
+    const uint8_t *font = (cellHeight == 16) ? DVIGetSystemFont16() : DVIGetSystemFont();
+    memset(dvi_textFont,0,sizeof(dvi_textFont));
+    for (int c = ' ';c < 256;c++) {
+        if (c != 0x7F) memcpy(dvi_textFont+c*cellHeight,font+(c-' ')*cellHeight,cellHeight);
+    }
+}
+
+/**
+ * @brief      Get the font the text modes are drawn with, cellHeight bytes for
+ *             each of the 256 characters, the leftmost pixel in bit 7.
+ *
+ * @return     Font data.
+ */
+const uint8_t *DVIGetTextFont(void) {
+    return dvi_textFont;
+}
+
+/**
+ * @brief      Set current mode, from its row in the mode table.
  *
  * @param[in]  mode  The mode to set.
  *
- * @return     0 if switched ok.
+ * @return     true if switched ok.
  */
 bool DVISetMode(DVIMODE mode) {
-    bool supported = true;
-    dvi_modeInfo.mode = mode;                                                       // Record mode
-
-    switch(mode) {
-
-        case MODE_640_480_8:                                                        // 640x480x8 information if enabled.
-            dvi_modeInfo.width = 640;dvi_modeInfo.height = 480;
-            dvi_modeInfo.bitPlaneCount = 3;
-            dvi_modeInfo.bitPlaneSize = PLANE_SIZE(640,480);
-            dvi_modeInfo.bitPlaneDepth = 1;
-            for (int i = 0;i <dvi_modeInfo.bitPlaneCount;i++)
-                dvi_modeInfo.bitPlane[i] = framebuf + dvi_modeInfo.bitPlaneSize * i;
-            dvi_modeInfo.bytesPerLine = dvi_modeInfo.width / 8;
-        break;
-
-        case MODE_640_240_8:                                                        // 640x240x8 information.
-            dvi_modeInfo.width = 640;dvi_modeInfo.height = 240;
-            dvi_modeInfo.bitPlaneCount = 3;
-            dvi_modeInfo.bitPlaneSize = PLANE_SIZE(640,240);
-            dvi_modeInfo.bitPlaneDepth = 1;
-            for (int i = 0;i <dvi_modeInfo.bitPlaneCount;i++)
-                dvi_modeInfo.bitPlane[i] = framebuf + dvi_modeInfo.bitPlaneSize * i;
-            dvi_modeInfo.bytesPerLine = dvi_modeInfo.width / 8;
-        break;
-
-        case MODE_320_240_8:                                                        // 320x240x8 information.
-            dvi_modeInfo.width = 320;dvi_modeInfo.height = 240;
-            dvi_modeInfo.bitPlaneCount = 3;
-            dvi_modeInfo.bitPlaneSize = PLANE_SIZE(320,240);
-            dvi_modeInfo.bitPlaneDepth = 1;
-            for (int i = 0;i <dvi_modeInfo.bitPlaneCount;i++)
-                dvi_modeInfo.bitPlane[i] = framebuf + dvi_modeInfo.bitPlaneSize * i;
-            dvi_modeInfo.bytesPerLine = dvi_modeInfo.width / 8;
-        break;
-
-        case MODE_320_256_8:                                                        // 320x256x8 information.
-            dvi_modeInfo.width = 320;dvi_modeInfo.height = 256;
-            dvi_modeInfo.bitPlaneCount = 3;
-            dvi_modeInfo.bitPlaneSize = PLANE_SIZE(320,256);
-            dvi_modeInfo.bitPlaneDepth = 1;
-            for (int i = 0;i <dvi_modeInfo.bitPlaneCount;i++)
-            dvi_modeInfo.bitPlane[i] = framebuf + dvi_modeInfo.bitPlaneSize * i;
-            dvi_modeInfo.bytesPerLine = dvi_modeInfo.width / 8;
-        break;
-
-        case MODE_320_240_64:                                                       // 320x240x64 information.
-            dvi_modeInfo.width = 320;dvi_modeInfo.height = 240;
-            dvi_modeInfo.bitPlaneCount = 3;
-            dvi_modeInfo.bitPlaneSize = PLANE_SIZE(320,240)*2;
-            dvi_modeInfo.bitPlaneDepth = 2;
-            for (int i = 0;i <dvi_modeInfo.bitPlaneCount;i++)
+    const DVIMODEDESCRIPTOR *md = DVIGetModeDescriptor(mode);
+    bool supported = (md != NULL);
+    int oldWidth = dvi_modeInfo.width,oldHeight = dvi_modeInfo.height;              // For the pointer.
+    dvi_modeDescriptor = NULL;                                                      // Scanout is blank while it changes.
+    dvi_modeInfo.mode = supported ? mode : -1;                                      // Record mode, or failed.
+    dvi_modeInfo.yOffset = 0;
+    if (supported) {
+        dvi_modeInfo.width = md->width;dvi_modeInfo.height = md->height;
+        dvi_modeInfo.bitPlaneCount = md->bitPlaneCount;
+        dvi_modeInfo.bitPlaneDepth = md->bitPlaneDepth;
+        dvi_modeInfo.isChunky = md->isChunky;
+        dvi_modeInfo.cellHeight = md->cellHeight;
+        if (md->cellHeight != 0) {                                                  // Text, a line is a row of cells.
+            dvi_modeInfo.bytesPerLine = md->width / 8 * md->bitPlaneDepth / 8;
+            dvi_modeInfo.bitPlaneSize = dvi_modeInfo.bytesPerLine * (md->height / md->cellHeight);
+            _DVILoadTextFont(md->cellHeight);
+        } else {
+            dvi_modeInfo.bytesPerLine = md->width * md->bitPlaneDepth / 8;
+            dvi_modeInfo.bitPlaneSize = dvi_modeInfo.bytesPerLine * md->height;
+        }
+        for (int i = 0;i < dvi_modeInfo.bitPlaneCount;i++) {
             dvi_modeInfo.bitPlane[i] = framebuf + dvi_modeInfo.bitPlaneSize * i;
-            dvi_modeInfo.bytesPerLine = dvi_modeInfo.width / 4;        
-            break;
-        default:
-            supported = false;
-            dvi_modeInfo.mode = -1;                                                 // Failed.
-            break;
         }
+        DVIBuildLineMap(md->lineRepeat,dvi_lineMap);
+    }
+    dvi_modeInfo.pageCount = supported ? VIDEO_BYTES / (dvi_modeInfo.bitPlaneSize * dvi_modeInfo.bitPlaneCount) : 0;
+    dvi_modeInfo.drawPage = dvi_modeInfo.displayPage = 0;                           // Drawing on, and showing, the first page.
+    DVISetRasterList(NULL,0);                                                       // Raster lines depend on the mode.
+    DVIRemoveSprites();                                                             // So do sprite positions.
+    DVIPointerModeChanged(oldWidth,oldHeight);                                      // The pointer stays where it was.
+    DVIResetPalette();                                                              // Palette back to the mode's default.
+    DVIMarkAllDirty();                                                              // Everything needs redrawing.
+    dvi_modeDescriptor = md;
     return supported;
 }
+
+/**
+ * @brief      Set the vertical scroll offset, the plane line shown at the top
+ *             of the display. Scrolling the whole display by n lines is
+ *             adding n to this, then redrawing the n lines that wrapped round.
+ *
+ * @param[in]  yOffset  Plane line, taken modulo the height.
+ */
+void DVISetScrollOffset(int yOffset) {
+    int height = dvi_modeInfo.height;
+    dvi_modeInfo.yOffset = ((yOffset % height) + height) % height;
+    DVIMarkAllDirty();                                                              // Every line of the display has moved.
+}
+
+/**
+ * @brief      Set the page that is shown. The scanout changes to it at the
+ *             start of the next frame, so use DVIWaitVSync() to wait for the
+ *             flip before drawing on the old one.
+ *
+ * @param[in]  page  Page number, 0 to pageCount-1
+ *
+ * @return     true if the page exists.
+ */
+bool DVISetDisplayPage(int page) {
+    if (page < 0 || page >= (int)dvi_modeInfo.pageCount) return false;
+    dvi_modeInfo.displayPage = page;
+    DVIMarkAllDirty();
+    return true;
+}
+
+/**
+ * @brief      Set the page that is drawn on, by pointing the bitplanes at it.
+ *
+ * @param[in]  page  Page number, 0 to pageCount-1
+ *
+ * @return     true if the page exists.
+ */
+bool DVISetDrawPage(int page) {
+    if (page < 0 || page >= (int)dvi_modeInfo.pageCount) return false;
+    dvi_modeInfo.drawPage = page;
+    for (int i = 0;i < dvi_modeInfo.bitPlaneCount;i++) {
+        dvi_modeInfo.bitPlane[i] = DVIGetPageAddress(&dvi_modeInfo,page) + dvi_modeInfo.bitPlaneSize * i;
+    }
+    return true;
+}
+
+/**
+ * @brief      Get the default palette colour for the current mode. The 16
+ *             colour mode has the 8 colours then the same at half brightness,
+ *             with 8 as dark grey. In the 256 colour mode 0-63 are the colours
+ *             of the 64 colour mode, and 64-255 are the same colours with
+ *             (colour >> 6) * 0x11 added to each component, like a tint.
+ *
+ * @param[in]  colour  Colour number
+ *
+ * @return     Colour as 0xRRGGBB
+ */
+uint32_t DVIGetDefaultPalette(int colour) {
+    uint32_t rgb = 0;
+    if (dvi_modeInfo.mode == MODE_320_240_256) {
+        int tint = (colour >> 6) * 0x11;
+        for (int c = 0;c < 3;c++) {                                                 // Red, green, blue
+            int level = ((colour >> c) & 1) * 2 + ((colour >> (c+3)) & 1);          // ..r..R as the 64 colour mode
+            int value = level * 0x55 + tint;
+            rgb |= ((value > 0xFF) ? 0xFF : value) << (16-c*8);
+        }
+    } else {
+        int level = (colour & 8) ? 0x80 : 0xFF;                                     // 8-15 are half brightness
+        if (colour == 8) return 0x404040;                                           // except black, which is dark grey.
+        for (int c = 0;c < 3;c++) {
+            if (colour & (1 << c)) rgb |= level << (16-c*8);
+        }
+    }
+    return rgb;
+}
+
+/**
+ * @brief      Set a palette entry. This only changes the chunky modes, the
+ *             colours of the bitplane modes are fixed.
+ *
+ * @param[in]  colour  Colour number, 0-255
+ * @param[in]  rgb     Colour as 0xRRGGBB
+ */
+void DVISetPalette(int colour,uint32_t rgb) {
+    if (colour < 0 || colour >= DVI_PALETTE_SIZE) return;
+    dvi_palette[colour] = rgb & 0xFFFFFF;
+    for (int c = 0;c < 3;c++) {                                                     // Symbols for each TMDS channel, blue first.
+        dvi_paletteSymbols[c][colour] = tmds_encode_balanced_pair((rgb >> (c*8)) & 0xFF);
+    }
+    DVIMarkAllDirty();
+}
+
+/**
+ * @brief      Get a palette entry
+ *
+ * @param[in]  colour  Colour number, 0-255
+ *
+ * @return     Colour as 0xRRGGBB
+ */
+uint32_t DVIGetPalette(int colour) {
+    return dvi_palette[colour & (DVI_PALETTE_SIZE-1)];
+}
+
+/**
+ * @brief      Reset the palette to the current mode's default.
+ */
+void DVIResetPalette(void) {
+    for (int i = 0;i < DVI_PALETTE_SIZE;i++) DVISetPalette(i,DVIGetDefaultPalette(i));
+}
@@ -11,33 +11,348 @@
 
 #include "dvi_module.h"
 #include "dvi_module_local.h"
+#include "tmds_buffers.h"
 
 //
 //        Frame buffer, these are 3 planar bitmaps for 640x480
 //
 
 uint8_t framebuf[VIDEO_BYTES];                                                      // Bitplane memory
+volatile uint32_t dvi_frameCount = 0;                                               // Frames scanned out.
 
 struct dvi_inst dvi0;                                                               // PicoDVI structure
 
-/**
- * @brief      Main core driver
- *
- */
-
 static uint8_t _buffer[80];                                                         // Buffer for line
+static uint8_t _cellPlanes[3][80] __attribute__((aligned(4)));                      // Text mode line, as 3 bitplanes.
 static uint16_t _mapping[256];                                                      // Table mapping 320 bits to 640 bits
 static uint32_t all_zero[20];
 static uint32_t all_one[20];
 
+static uint32_t _rasterPalette[3][DVI_PALETTE_SIZE];                                // Palette symbols changed by the raster list.
+
+static DVISPRITE _frameSprites[DVI_SPRITE_ENTRIES];                                 // Sprite table for this frame.
+static uint32_t _spriteLines[FRAME_HEIGHT];                                         // Sprites on each display line, a bit each.
+static uint8_t _spriteBuffer[3][FRAME_WIDTH/2] __attribute__((aligned(4)));         // Lines copied to draw sprites on.
+
+/**
+ * @brief      Take a buffer PicoDVI has finished scanning out off its free
+ *             queue.
+ *
+ * @param[in]  wait  Wait for one if there are none
+ *
+ * @return     The buffer, NULL if there are none and not waiting.
+ */
+uint32_t * __not_in_flash("main") DVITakeReturnedBuffer(bool wait) {
+    uint32_t *buffer = NULL;
+    if (wait) {
+        queue_remove_blocking_u32(&dvi0.q_tmds_free,&buffer);
+    } else {
+        queue_try_remove_u32(&dvi0.q_tmds_free,&buffer);
+    }
+    return buffer;
+}
+
+/**
+ * @brief      Pass a buffer to PicoDVI for the next output line.
+ *
+ * @param      buffer  The buffer
+ */
+void __not_in_flash("main") DVISendBuffer(uint32_t *buffer) {
+    queue_add_blocking_u32(&dvi0.q_tmds_valid,&buffer);
+}
+
+/**
+ * @brief      Carry out a raster list entry. Palette changes are made to a copy
+ *             of the palette's symbols, which is taken at the first one in each
+ *             frame.
+ *
+ * @param[in]  n         Raster list entry
+ * @param      yOffset   Scroll offset for the rest of the frame
+ * @param      palette   Palette symbols for the rest of the frame
+ */
+static void __not_in_flash("main") _DVIRasterAction(int n,uint *yOffset,uint32_t (**palette)[DVI_PALETTE_SIZE]) {
+    DVIRASTERENTRY *r = &dvi_rasterList[n];
+    switch(r->action) {
+        case DVI_RASTER_OFFSET:
+            *yOffset = r->value % dvi_modeInfo.height;
+            break;
+        case DVI_RASTER_PALETTE:
+            if (*palette != _rasterPalette) {                                       // First change this frame.
+                memcpy(_rasterPalette,dvi_paletteSymbols,sizeof(_rasterPalette));
+                *palette = _rasterPalette;
+            }
+            for (int c = 0;c < 3;c++) (*palette)[c][(r->value >> 24) & 0xFF] = dvi_rasterSymbols[n][c];
+            break;
+    }
+}
+
+//
+//      Line encoders, one for each DVIENCODER. Each is given the line in each plane (the chunky modes only have
+//      the first) and fills a TMDS buffer. The text modes are drawn into 1 bit planes first.
+//
+typedef void (*DVILINEENCODER)(uint8_t **planes,uint32_t *tmdsbuf,uint32_t (*palette)[DVI_PALETTE_SIZE]);
+
+/**
+ * @brief      640 pixels, 3 bitplanes.
+ *
+ * @param      planes   Line in each plane
+ * @param      tmdsbuf  TMDS buffer
+ * @param      palette  Palette symbols (not used)
+ */
+static void __not_in_flash("main") _DVIEncode1bpp(uint8_t **planes,uint32_t *tmdsbuf,uint32_t (*palette)[DVI_PALETTE_SIZE]) {
+    for (uint component = 0; component < 3; ++component) {
+        tmds_encode_custom_1bpp((const uint32_t*)planes[component],
+                                tmdsbuf + (2-component) * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,   // The (2-x) here makes it BGR Acorn standard
+                                FRAME_WIDTH);
+    }
+}
+
+/**
+ * @brief      320 pixels, 3 bitplanes, each pixel doubled with the mapping
+ *             table before encoding.
+ *
+ * @param      planes   Line in each plane
+ * @param      tmdsbuf  TMDS buffer
+ * @param      palette  Palette symbols (not used)
+ */
+static void __not_in_flash("main") _DVIEncode1bppDouble(uint8_t **planes,uint32_t *tmdsbuf,uint32_t (*palette)[DVI_PALETTE_SIZE]) {
+    for (uint component = 0; component < 3; ++component) {
+        const uint8_t *_source = planes[component];
+        uint16_t *_target = (uint16_t *)_buffer;
+
+        for (int i = 0;i < 320/8;i++) {
+            *_target++ = _mapping[*_source++];
+        }
+
+        tmds_encode_custom_1bpp((const uint32_t*)_buffer,
+                                tmdsbuf + (2-component) * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,   // The (2-x) here makes it BGR Acorn standard
+                                FRAME_WIDTH);
+    }
+}
+
+/**
+ * @brief      320 pixels, 3 bitplanes of 2 bits per pixel.
+ *
+ * @param      planes   Line in each plane
+ * @param      tmdsbuf  TMDS buffer
+ * @param      palette  Palette symbols (not used)
+ */
+static void __not_in_flash("main") _DVIEncode2bpp(uint8_t **planes,uint32_t *tmdsbuf,uint32_t (*palette)[DVI_PALETTE_SIZE]) {
+    for (uint component = 0; component < 3; ++component) {
+        tmds_encode_custom_2bpp((const uint32_t*)planes[component],
+                                tmdsbuf + (2-component) * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,   // The (2-x) here makes it BGR Acorn standard
+                                FRAME_WIDTH);
+    }
+}
+
+/**
+ * @brief      320 packed 4 bit pixels, looked up in the palette's symbols.
+ *
+ * @param      planes   Line of pixels in the first
+ * @param      tmdsbuf  TMDS buffer
+ * @param      palette  Palette symbols, blue green red
+ */
+static void __not_in_flash("main") _DVIEncodePalette4bpp(uint8_t **planes,uint32_t *tmdsbuf,uint32_t (*palette)[DVI_PALETTE_SIZE]) {
+    for (uint channel = 0; channel < 3; ++channel) {
+        tmds_encode_palette_4bpp(planes[0],tmdsbuf + channel * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,FRAME_WIDTH,palette[channel]);
+    }
+}
+
+/**
+ * @brief      320 packed 8 bit pixels, looked up in the palette's symbols.
+ *
+ * @param      planes   Line of pixels in the first
+ * @param      tmdsbuf  TMDS buffer
+ * @param      palette  Palette symbols, blue green red
+ */
+static void __not_in_flash("main") _DVIEncodePalette8bpp(uint8_t **planes,uint32_t *tmdsbuf,uint32_t (*palette)[DVI_PALETTE_SIZE]) {
+    for (uint channel = 0; channel < 3; ++channel) {
+        tmds_encode_palette_8bpp(planes[0],tmdsbuf + channel * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,FRAME_WIDTH,palette[channel]);
+    }
+}
+
+static DVILINEENCODER _encoders[DVI_ENCODER_COUNT] = {                              // In RAM, indexed by DVIENCODER
+    _DVIEncode1bpp,_DVIEncode1bppDouble,_DVIEncode2bpp,_DVIEncodePalette4bpp,_DVIEncodePalette8bpp,
+    _DVIEncode1bpp,_DVIEncode1bppDouble                                             // Text modes, once drawn into planes.
+};
+
+/**
+ * @brief      Draw a line of character cells into 3 bitplanes, through the
+ *             font in RAM. Each plane's byte is the font's pixels where the
+ *             foreground has that colour bit, and the rest where the
+ *             background has it.
+ *
+ * @param[in]  page     Page being shown
+ * @param[in]  source   Plane line, in pixels
+ */
+static void __not_in_flash("main") _DVIExpandCells(const uint8_t *page,uint source) {
+    uint cellHeight = dvi_modeInfo.cellHeight;
+    uint columns = dvi_modeInfo.bytesPerLine / 2;
+    const uint16_t *cell = (const uint16_t *)(page + source / cellHeight * dvi_modeInfo.bytesPerLine);
+    const uint8_t *font = dvi_textFont + source % cellHeight;                       // Font line for this line of the row.
+    for (uint x = 0;x < columns;x++) {
+        uint c = *cell++;
+        uint pixels = font[DVI_CELL_CHAR(c) * cellHeight];
+        for (uint plane = 0;plane < 3;plane++) {
+            uint fgMask = ((c >> (8+plane)) & 1) ? 0xFF : 0x00;                     // Colour bits as masks.
+            uint bgMask = ((c >> (12+plane)) & 1) ? 0xFF : 0x00;
+            _cellPlanes[plane][x] = (pixels & fgMask) | (~pixels & bgMask);
+        }
+    }
+}
+
+/**
+ * @brief      Take the sprite table for this frame, and work out which
+ *             sprites are on each display line, so each line only has to look
+ *             them up.
+ */
+static void __not_in_flash("main") _DVIBuildSpriteLines(void) {
+    memcpy(_frameSprites,dvi_sprites,sizeof(_frameSprites));
+    memset(_spriteLines,0,sizeof(_spriteLines));
+    for (int n = 0;n < DVI_SPRITE_ENTRIES;n++) {                                    // The pointer is the last one.
+        DVISPRITE *s = &_frameSprites[n];
+        if (!s->isVisible) continue;
+        int yTop = (s->y < 0) ? 0 : s->y;                                           // Lines it is on, clipped to the display.
+        int yBottom = s->y + s->height;
+        if (yBottom > (int)dvi_modeInfo.height) yBottom = dvi_modeInfo.height;
+        for (int y = yTop;y < yBottom;y++) _spriteLines[y] |= (1 << n);
+    }
+}
+
+/**
+ * @brief      Get a row of a sprite as three planes of pixels and a mask, the
+ *             leftmost pixel in bit 31. A 1 bit image is in the planes where
+ *             its colour has that bit set.
+ *
+ * @param[in]  s     Sprite
+ * @param[in]  row   Row in the sprite
+ * @param      bits  Pixels for each plane
+ * @param      mask  Set where the sprite is drawn.
+ */
+static void __not_in_flash("main") _DVISpriteRow(const DVISPRITE *s,int row,uint32_t *bits,uint32_t *mask) {
+    if (s->depth == 1) {
+        for (int p = 0;p < 3;p++) bits[p] = ((s->colour >> p) & 1) ? s->image[row] : 0;
+        *mask = s->image[row];
+    } else {
+        for (int p = 0;p < 3;p++) bits[p] = s->image[p * s->height + row];
+        *mask = bits[0] | bits[1] | bits[2];
+    }
+    if (s->mask != NULL) *mask = s->mask[row];
+    *mask &= 0xFFFFFFFF << (32 - s->width);                                         // Nothing past the right edge.
+}
+
+/**
+ * @brief      Draw a row of a sprite on 3 bitplanes of 1 bit per pixel, a byte
+ *             at a time.
+ *
+ * @param[in]  s       Sprite
+ * @param[in]  row     Row in the sprite
+ * @param      planes  Line in each plane
+ */
+static void __not_in_flash("main") _DVIDrawSprite1bpp(const DVISPRITE *s,int row,uint8_t **planes) {
+    uint32_t bits[3],mask;
+    _DVISpriteRow(s,row,bits,&mask);
+    int x = s->x;
+    if (x < 0) {                                                                    // Clip off the left.
+        if (x <= -32) return;
+        mask <<= -x;
+        for (int p = 0;p < 3;p++) bits[p] <<= -x;
+        x = 0;
+    }
+    int first = x / 8,shift = x % 8,bytes = dvi_modeInfo.width / 8;
+    for (int k = 0;k < 5 && first+k < bytes;k++) {                                  // Up to 5 bytes, from the left.
+        uint8_t m = (((uint64_t)mask << 32) >> shift) >> (56-k*8);
+        if (m == 0) continue;
+        for (int p = 0;p < 3;p++) {
+            uint8_t b = (((uint64_t)bits[p] << 32) >> shift) >> (56-k*8);
+            planes[p][first+k] = (planes[p][first+k] & ~m) | (b & m);
+        }
+    }
+}
+
+/**
+ * @brief      Draw a row of a sprite a pixel at a time, for the 64 colour and
+ *             chunky modes. 3 bit pixels are the colour number, or in the 64
+ *             colour mode that colour at full brightness.
+ *
+ * @param[in]  s       Sprite
+ * @param[in]  row     Row in the sprite
+ * @param      planes  Line in each plane
+ */
+static void __not_in_flash("main") _DVIDrawSpritePixels(const DVISPRITE *s,int row,uint8_t **planes) {
+    uint32_t bits[3],mask;
+    _DVISpriteRow(s,row,bits,&mask);
+    for (int i = 0;i < s->width;i++) {
+        int x = s->x + i;
+        uint32_t bit = 0x80000000 >> i;
+        if ((mask & bit) == 0 || x < 0 || x >= (int)dvi_modeInfo.width) continue;
+        uint colour = (s->image[row] & bit) ? s->colour : 0;
+        if (s->depth == 3) colour = ((bits[0] & bit) ? 1 : 0) | ((bits[1] & bit) ? 2 : 0) | ((bits[2] & bit) ? 4 : 0);
+        if (dvi_modeInfo.isChunky) {
+            if (dvi_modeInfo.bitPlaneDepth == 8) {
+                planes[0][x] = colour;
+            } else {                                                                // Left pixel in the upper 4 bits.
+                uint shift = (x & 1) ? 0 : 4;
+                planes[0][x/2] = (planes[0][x/2] & ~(0x0F << shift)) | ((colour & 0x0F) << shift);
+            }
+        } else {
+            if (s->depth == 3) colour *= 9;                                         // Both bits of each level, ..r..R
+            uint shift = 6 - (x & 3) * 2;
+            for (int p = 0;p < 3;p++) {
+                uint level = ((colour >> p) & 1) * 2 + ((colour >> (p+3)) & 1);
+                planes[p][x/4] = (planes[p][x/4] & ~(3 << shift)) | (level << shift);
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Draw the sprites on a display line. The bitmap modes' lines are
+ *             copied out of framebuf first, so it is not changed.
+ *
+ * @param      planes   Line in each plane, changed to the copy.
+ * @param[in]  display  Display line
+ * @param[in]  onLine   Sprites on it, a bit each.
+ */
+static void __not_in_flash("main") _DVIDrawSprites(uint8_t **planes,uint display,uint32_t onLine) {
+    bool is1bpp = (dvi_modeInfo.cellHeight != 0 || dvi_modeInfo.bitPlaneDepth == 1);
+    if (dvi_modeInfo.cellHeight == 0) {
+        for (uint p = 0;p < (dvi_modeInfo.isChunky ? 1 : 3);p++) {
+            memcpy(_spriteBuffer[p],planes[p],dvi_modeInfo.bytesPerLine);
+            planes[p] = _spriteBuffer[p];
+        }
+    }
+    for (int n = 0;onLine != 0;n++,onLine >>= 1) {                                  // Lowest numbered first.
+        if (onLine & 1) {
+            const DVISPRITE *s = &_frameSprites[n];
+            if (is1bpp) {
+                _DVIDrawSprite1bpp(s,display - s->y,planes);
+            } else {
+                _DVIDrawSpritePixels(s,display - s->y,planes);
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Main core driver. Each source line is TMDS encoded once, and the
+ *             buffer queued for every output line that shows it. The mode's
+ *             line map and encoder come from its row in the mode table.
+ *             While the mode is changing it queues blank lines, so y stays in
+ *             step with the scanout, and the new mode starts with a frame.
+ *
+ */
 void __not_in_flash("main") dvi_core1_main() {
 
-    uint32_t *tmdsbuf;
+    uint32_t *tmdsbuf = NULL;
+    bool isBlank = false;                                                           // tmdsbuf holds a blank line.
     dvi_register_irqs_this_core(&dvi0, DMA_IRQ_0);
     dvi_start(&dvi0);
     uint y = -1;
-    uint y0 = 0;
-    uint y1 = 0;
+    int rasterNext = 0;                                                             // Next raster list entry
+    uint yOffset = 0;                                                               // Scroll offset and palette for this part of the frame.
+    uint32_t (*palette)[DVI_PALETTE_SIZE] = dvi_paletteSymbols;
+    uint displayPage = 0;                                                           // Page shown this frame.
     //
     //    This table maps an 8 bit bit pattern into a 'double width' 16 bit pattern.
     //
@@ -52,83 +367,51 @@ void __not_in_flash("main") dvi_core1_main() {
         all_one[i] = 0xffffffff;
         all_zero[i] = 0;
     }
+    uint8_t *blankPlanes[3] = { (uint8_t *)all_zero,(uint8_t *)all_zero,(uint8_t *)all_zero };
+    const DVIMODEDESCRIPTOR *md = NULL;                                             // Mode shown this frame.
     while (true) {
         y = (y + 1) % FRAME_HEIGHT;
-        switch(dvi_modeInfo.mode) {
-            //
-            //    Mode is 640x240x8 colours as 3 bitplanes.
-            //
-            case MODE_640_240_8:
-                queue_remove_blocking_u32(&dvi0.q_tmds_free, &tmdsbuf);
-                for (uint component = 0; component < 3; ++component) {
-                tmds_encode_custom_1bpp((const uint32_t*)(framebuf+(y/2)*640/8 + component * dvi_modeInfo.bitPlaneSize),
-                                        tmdsbuf + (2-component) * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,   // The (2-x) here makes it BGR Acorn standard
-                                        FRAME_WIDTH);
-                }
-                queue_add_blocking_u32(&dvi0.q_tmds_valid, &tmdsbuf);
-                break;
-
-            //
-            //    Mode is 640x480x8 colours as 3 bitplanes.
-            //
-            case MODE_640_480_8:
-                queue_remove_blocking_u32(&dvi0.q_tmds_free, &tmdsbuf);
-                for (uint component = 0; component < 3; ++component) {
-                tmds_encode_custom_1bpp((const uint32_t*)(framebuf+y*640/8 + component * dvi_modeInfo.bitPlaneSize),
-                                        tmdsbuf + (2-component) * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,   // The (2-x) here makes it BGR Acorn standard
-                                        FRAME_WIDTH);
-                }
-                queue_add_blocking_u32(&dvi0.q_tmds_valid, &tmdsbuf);
-                break;
-
-            //
-            //    Mode is 320x240x8 colours as 3 bitplanes, also supports 320x256x8 for BBC Micro compatibility
-            //
-            case MODE_320_240_8:
-            case MODE_320_256_8:
-                queue_remove_blocking_u32(&dvi0.q_tmds_free, &tmdsbuf);
-                for (uint component = 0; component < 3; ++component) {
-                    uint8_t *_source = framebuf+(y0)*320/8 + component * dvi_modeInfo.bitPlaneSize;
-                    uint16_t *_target = (uint16_t *)_buffer;
-
-                    for (int i = 0;i < 320/8;i++) {
-                    *_target++ = _mapping[*_source++];
-                    }
-
-                    tmds_encode_custom_1bpp((const uint32_t*)_buffer,
-                                            tmdsbuf + (2-component) * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,   // The (2-x) here makes it BGR Acorn standard
-                                            FRAME_WIDTH);
-                }
-                queue_add_blocking_u32(&dvi0.q_tmds_valid, &tmdsbuf);
-
-                if (dvi_modeInfo.mode == MODE_320_256_8 && (y1==14))  {         // This squeezes 256 lines into 480 :)
-                    y0 += 1; y1 = 0;
-                } else {
-                    if (y1 & 1) {
-                        y0+=1;
-                    }
-                    y1 +=1;
-                }
-                if (y == 479) {
-                    y0 = 0;y1 = 0;
-                }
-                break;
-
-            //
-            //    Mode is 320x240x64 colours
-            //
-            case MODE_320_240_64:
-                queue_remove_blocking_u32(&dvi0.q_tmds_free, &tmdsbuf);
-                for (uint component = 0; component < 3; ++component) {
-                    tmds_encode_custom_2bpp((const uint32_t*)(framebuf+(y/2)*640/8 + component * dvi_modeInfo.bitPlaneSize),
-                                            tmdsbuf + (2-component) * FRAME_WIDTH / DVI_SYMBOLS_PER_WORD,   // The (2-x) here makes it BGR Acorn standard
-                                            FRAME_WIDTH);
-                }
-                queue_add_blocking_u32(&dvi0.q_tmds_valid, &tmdsbuf);
-            break;
-
-            default:
-                break;
+        if (y == 0) {                                                               // Start of frame, as set up by the app.
+            dvi_frameCount++;                                                       // Passed the last line, so vertical sync.
+            md = dvi_modeDescriptor;
+            if (md != NULL) {
+                displayPage = dvi_modeInfo.displayPage;                             // Page flips happen here.
+                rasterNext = 0;yOffset = dvi_modeInfo.yOffset;palette = dvi_paletteSymbols;
+                _DVIBuildSpriteLines();
+            }
+        }
+        if (dvi_modeDescriptor != md) md = NULL;                                    // Mode changing, blank to the end of the frame.
+        if (md == NULL) {                                                           // No mode, or changing mode, so a blank
+            if (!isBlank) {                                                         // line, which keeps y in step with the
+                tmdsbuf = DVIGetTMDSBuffer();                                       // scanout.
+                _DVIEncode1bpp(blankPlanes,tmdsbuf,NULL);
+                isBlank = true;
+            }
+            DVIQueueTMDSBuffer(tmdsbuf);
+            continue;
+        }
+        uint display = dvi_lineMap[y];                                              // Display line for this output line.
+        if (tmdsbuf != NULL && !isBlank && y != 0 && display == dvi_lineMap[y-1]) { // Same display line as the last one
+            DVIQueueTMDSBuffer(tmdsbuf);                                            // so show the same encoding again.
+            continue;
         }
+        while (rasterNext < dvi_rasterCount && dvi_rasterList[rasterNext].line <= display) {
+            _DVIRasterAction(rasterNext++,&yOffset,&palette);                       // Raster list changes from this line.
+        }
+        uint source = display + yOffset;                                            // Plane line, after the scroll offset.
+        if (source >= dvi_modeInfo.height) source -= dvi_modeInfo.height;
+        uint8_t *page = DVIGetPageAddress(&dvi_modeInfo,displayPage);               // Planes being shown.
+        uint8_t *planes[3];
+        if (dvi_modeInfo.cellHeight != 0) {                                         // Text, draw the cells into planes.
+            _DVIExpandCells(page,source);
+            for (int p = 0;p < 3;p++) planes[p] = _cellPlanes[p];
+        } else {
+            for (int p = 0;p < 3;p++) planes[p] = page + source * dvi_modeInfo.bytesPerLine + p * dvi_modeInfo.bitPlaneSize;
+        }
+        if (_spriteLines[display] != 0) _DVIDrawSprites(planes,display,_spriteLines[display]);
+
+        tmdsbuf = DVIGetTMDSBuffer();isBlank = false;
+        (*_encoders[md->encoder])(planes,tmdsbuf,palette);
+        DVIQueueTMDSBuffer(tmdsbuf);
     }
 }
@@ -0,0 +1,60 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :       raster.c
+//      Purpose :    Raster list, changes to the scanout part way down the display
+//      Date :       17th October 2026
+//      Author :     Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include "dvi_module.h"
+#include "tmds_encode_reference.h"
+
+DVIRASTERENTRY dvi_rasterList[DVI_MAX_RASTER];                                      // Raster list, in line order.
+uint32_t dvi_rasterSymbols[DVI_MAX_RASTER][3];                                      // TMDS symbol pairs for palette entries, blue green red.
+volatile int dvi_rasterCount = 0;                                                   // Entries in use.
+
+/**
+ * @brief      Set the raster list, replacing the current one. Core 1 works
+ *             through it as it scans out each frame. Palette entries have
+ *             their TMDS symbols worked out here, so the scanout only has to
+ *             copy them.
+ *
+ * @param[in]  list   Entries, in line order
+ * @param[in]  count  Number of entries, 0 removes the list.
+ *
+ * @return     true if set, false if there are too many, or they are not in
+ *             order, in which case there is no list.
+ */
+bool DVISetRasterList(const DVIRASTERENTRY *list,int count) {
+    dvi_rasterCount = 0;                                                            // Stop the scanout using it while it changes.
+    if (count < 0 || count > DVI_MAX_RASTER) return false;
+    for (int i = 0;i < count;i++) {
+        if (i > 0 && list[i].line < list[i-1].line) return false;                   // Must be in order.
+        dvi_rasterList[i] = list[i];
+        for (int c = 0;c < 3;c++) {                                                 // Symbols for each TMDS channel, blue first.
+            dvi_rasterSymbols[i][c] = tmds_encode_balanced_pair((list[i].value >> (c*8)) & 0xFF);
+        }
+    }
+    dvi_rasterCount = count;
+    DVIMarkAllDirty();
+    return true;
+}
+
+/**
+ * @brief      Get the current raster list.
+ *
+ * @param      list  Buffer for the entries, DVI_MAX_RASTER of them, or NULL to
+ *                   just get the count.
+ *
+ * @return     Number of entries.
+ */
+int DVIGetRasterList(DVIRASTERENTRY *list) {
+    int count = dvi_rasterCount;
+    if (list != NULL) {
+        for (int i = 0;i < count;i++) list[i] = dvi_rasterList[i];
+    }
+    return count;
+}
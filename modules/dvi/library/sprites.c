@@ -0,0 +1,177 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :       sprites.c
+//      Purpose :    Sprites, drawn over the display by the scanout
+//      Date :       17th October 2026
+//      Author :     Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include "dvi_module.h"
+
+DVISPRITE dvi_sprites[DVI_SPRITE_ENTRIES];                                          // Sprite table, read by the scanout each frame.
+
+//
+//      The default pointer, an arrow with a black outline.
+//
+static const uint32_t _arrowImage[DVI_POINTER_SIZE] = {
+    0x00000000,0x40000000,0x60000000,0x70000000,0x78000000,0x7C000000,0x7E000000,0x7F000000,
+    0x7F800000,0x7C000000,0x6E000000,0x46000000,0x03000000,0x01000000,0x00000000,0x00000000
+};
+
+static const uint32_t _arrowMask[DVI_POINTER_SIZE] = {
+    0xE0000000,0xF0000000,0xF8000000,0xFC000000,0xFE000000,0xFF000000,0xFF800000,0xFFC00000,
+    0xFFC00000,0xFFC00000,0xFF000000,0xFF800000,0xEF800000,0x07800000,0x03800000,0x00000000
+};
+
+static int xPointer = 0,yPointer = 0;                                               // Pointer position and hot spot.
+static int xHotSpot = 0,yHotSpot = 0;
+
+/**
+ * @brief      Mark the lines a sprite covers as changed, for the runtime.
+ *
+ * @param[in]  n     Sprite number
+ */
+static void _DVIMarkSprite(int n) {
+    DVISPRITE *s = &dvi_sprites[n];
+    if (s->isVisible) DVIMarkDirty(s->y,s->y+s->height-1);
+}
+
+/**
+ * @brief      Set up a sprite. The scanout takes the sprite table at the start
+ *             of each frame, so the change shows from the next one.
+ *
+ * @param[in]  n       Sprite number, 0 to DVI_MAX_SPRITES-1
+ * @param[in]  sprite  Sprite, which is copied, or NULL to remove it.
+ *
+ * @return     true if it was set, false if the number or sprite are not
+ *             valid, in which case the sprite is removed.
+ */
+bool DVISetSprite(int n,const DVISPRITE *sprite) {
+    if (n < 0 || n >= DVI_MAX_SPRITES) return false;
+    _DVIMarkSprite(n);                                                              // Where it was.
+    dvi_sprites[n].isVisible = false;
+    if (sprite == NULL) return true;
+    if (sprite->width < 1 || sprite->width > DVI_SPRITE_SIZE || sprite->height < 1 || sprite->height > DVI_SPRITE_SIZE ||
+                                    (sprite->depth != 1 && sprite->depth != 3) || sprite->image == NULL) return false;
+    dvi_sprites[n] = *sprite;
+    _DVIMarkSprite(n);                                                              // Where it is now.
+    return true;
+}
+
+/**
+ * @brief      Move a sprite, which only changes its position.
+ *
+ * @param[in]  n     Sprite number
+ * @param[in]  x     New left, in pixels
+ * @param[in]  y     New top, in display lines
+ *
+ * @return     true if the sprite exists.
+ */
+bool DVIMoveSprite(int n,int x,int y) {
+    if (n < 0 || n >= DVI_MAX_SPRITES) return false;
+    _DVIMarkSprite(n);
+    dvi_sprites[n].x = x;dvi_sprites[n].y = y;
+    _DVIMarkSprite(n);
+    return true;
+}
+
+/**
+ * @brief      Get a sprite's settings.
+ *
+ * @param[in]  n       Sprite number, or DVI_POINTER_SPRITE
+ * @param      sprite  Where to put them.
+ *
+ * @return     true if the sprite exists.
+ */
+bool DVIGetSprite(int n,DVISPRITE *sprite) {
+    if (n < 0 || n >= DVI_SPRITE_ENTRIES) return false;
+    *sprite = dvi_sprites[n];
+    return true;
+}
+
+/**
+ * @brief      Remove all the sprites, which DVISetMode() does. The pointer
+ *             stays as it is.
+ */
+void DVIRemoveSprites(void) {
+    for (int n = 0;n < DVI_MAX_SPRITES;n++) DVISetSprite(n,NULL);
+}
+
+/**
+ * @brief      Position the pointer sprite so its hot spot is on the pointer
+ *             position, and in white for the current mode.
+ */
+static void _DVIUpdatePointer(void) {
+    DVISPRITE *s = &dvi_sprites[DVI_POINTER_SPRITE];
+    _DVIMarkSprite(DVI_POINTER_SPRITE);
+    s->x = xPointer - xHotSpot;s->y = yPointer - yHotSpot;
+    DVIMODEINFO *dm = DVIGetModeInformation();
+    s->colour = (dm->bitPlaneDepth == 2 || dm->bitPlaneDepth == 8) ? 63 : 7;        // White is 63 in the 64 and 256 colour modes.
+    _DVIMarkSprite(DVI_POINTER_SPRITE);
+}
+
+/**
+ * @brief      Set the pointer's image. It is drawn white where the image is
+ *             set, and black where only the mask is.
+ *
+ * @param[in]  image  16 rows, the leftmost pixel in bit 31, or NULL for the
+ *                    default arrow. This is not copied.
+ * @param[in]  mask   16 rows, or NULL to use the image.
+ * @param[in]  xHot   Hot spot, the pixel at the pointer position.
+ * @param[in]  yHot   Hot spot, vertically.
+ */
+void DVISetPointer(const uint32_t *image,const uint32_t *mask,int xHot,int yHot) {
+    DVISPRITE *s = &dvi_sprites[DVI_POINTER_SPRITE];
+    _DVIMarkSprite(DVI_POINTER_SPRITE);
+    if (image == NULL) {                                                            // The default arrow.
+        image = _arrowImage;mask = _arrowMask;xHot = yHot = 1;
+    }
+    s->width = s->height = DVI_POINTER_SIZE;s->depth = 1;
+    s->image = image;s->mask = mask;
+    xHotSpot = xHot;yHotSpot = yHot;
+    _DVIUpdatePointer();
+}
+
+/**
+ * @brief      Show or hide the pointer.
+ *
+ * @param[in]  isVisible  true to show it.
+ */
+void DVIShowPointer(bool isVisible) {
+    if (dvi_sprites[DVI_POINTER_SPRITE].image == NULL) DVISetPointer(NULL,NULL,0,0);
+    _DVIMarkSprite(DVI_POINTER_SPRITE);
+    dvi_sprites[DVI_POINTER_SPRITE].isVisible = isVisible;
+    _DVIMarkSprite(DVI_POINTER_SPRITE);
+}
+
+/**
+ * @brief      Move the pointer, which the input module does as the mouse
+ *             moves. Like the sprites this is only a position, the scanout
+ *             draws it over the display.
+ *
+ * @param[in]  x     Hot spot position, in pixels
+ * @param[in]  y     And display lines.
+ */
+void DVIMovePointer(int x,int y) {
+    xPointer = x;yPointer = y;
+    _DVIUpdatePointer();
+}
+
+/**
+ * @brief      Keep the pointer in the same place on the display when the mode
+ *             changes, and in the new mode's white. Called by DVISetMode().
+ *
+ * @param[in]  oldWidth   Width of the last mode.
+ * @param[in]  oldHeight  Height of the last mode.
+ */
+void DVIPointerModeChanged(int oldWidth,int oldHeight) {
+    DVIMODEINFO *dm = DVIGetModeInformation();
+    if (oldWidth > 0 && oldHeight > 0) {
+        xPointer = xPointer * (int)dm->width / oldWidth;
+        yPointer = yPointer * (int)dm->height / oldHeight;
+    }
+    _DVIUpdatePointer();
+}
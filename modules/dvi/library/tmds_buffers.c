@@ -0,0 +1,91 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      tmds_buffers.c
+//      Purpose :   TMDS buffer scheduling for repeated lines
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <stddef.h>
+#include "tmds_buffers.h"
+
+#ifdef RUNTIME
+#define __not_in_flash(group)
+#else
+#include "pico.h"                                                                   // These run on core 1, from RAM.
+#endif
+
+//
+//      A TMDS buffer can be queued for more than one output line, so it is only really free when all of
+//      those have come back. The first time a buffer is seen it is one of the ones PicoDVI started with.
+//
+#define MAX_TMDS_BUFFERS    (8)
+
+static uint32_t *_tmdsBuffer[MAX_TMDS_BUFFERS];                                     // Buffers seen so far
+static uint8_t _tmdsQueued[MAX_TMDS_BUFFERS];                                       // Times each is queued and not yet back.
+static uint32_t *_tmdsReady[MAX_TMDS_BUFFERS];                                      // Buffers back, and not queued.
+static int _tmdsBufferCount = 0,_tmdsReadyCount = 0;
+static int _tmdsOutstanding = 0;                                                    // Queued, and not yet taken back.
+
+/**
+ * @brief      Forget all the buffers, for a new set of queues.
+ */
+void DVIResetTMDSBuffers(void) {
+    _tmdsBufferCount = _tmdsReadyCount = _tmdsOutstanding = 0;
+}
+
+/**
+ * @brief      A buffer has come back from the free queue ; if it is not queued
+ *             for another line it can be reused. A buffer is only added to the
+ *             ready list when its count reaches zero, and is only queued again
+ *             after being taken off it, so it is never on the list twice.
+ *
+ * @param      buffer  The buffer
+ */
+static void __not_in_flash("main") _DVIBufferReturned(uint32_t *buffer) {
+    int i = 0;
+    while (i < _tmdsBufferCount && _tmdsBuffer[i] != buffer) i++;                   // Find it
+    if (i == _tmdsBufferCount) {                                                    // First time it has been seen.
+        if (_tmdsBufferCount == MAX_TMDS_BUFFERS) return;
+        _tmdsBuffer[_tmdsBufferCount] = buffer;_tmdsQueued[_tmdsBufferCount++] = 0;
+        _tmdsReady[_tmdsReadyCount++] = buffer;
+        return;
+    }
+    _tmdsOutstanding--;
+    if (--_tmdsQueued[i] == 0) _tmdsReady[_tmdsReadyCount++] = buffer;              // Nothing else waiting on it.
+}
+
+/**
+ * @brief      Get a buffer to encode a line into. This is never one that is
+ *             still waiting to be scanned out.
+ *
+ * @return     TMDS buffer.
+ */
+uint32_t * __not_in_flash("main") DVIGetTMDSBuffer(void) {
+    while (_tmdsReadyCount == 0) _DVIBufferReturned(DVITakeReturnedBuffer(true));   // Wait for one to come back.
+    return _tmdsReady[--_tmdsReadyCount];
+}
+
+/**
+ * @brief      Queue a buffer for the next output line. It is counted before any
+ *             returns are taken, as one of those may be its last scanout, which
+ *             would otherwise make it ready while it is being queued again. The
+ *             returns are all taken before it is sent, so the free queue holds
+ *             only returns of buffers sent since, and it is not sent until fewer
+ *             than the free queue's size are out, so the free queue cannot fill.
+ *
+ * @param      buffer  The buffer
+ */
+void __not_in_flash("main") DVIQueueTMDSBuffer(uint32_t *buffer) {
+    uint32_t *returned;
+    for (int i = 0;i < _tmdsBufferCount;i++) {
+        if (_tmdsBuffer[i] == buffer) _tmdsQueued[i]++;
+    }
+    while ((returned = DVITakeReturnedBuffer(false)) != NULL) _DVIBufferReturned(returned);
+    while (_tmdsOutstanding >= DVI_TMDS_FREE_QUEUE_SIZE) _DVIBufferReturned(DVITakeReturnedBuffer(true));
+    _tmdsOutstanding++;
+    DVISendBuffer(buffer);
+}
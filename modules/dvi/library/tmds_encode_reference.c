@@ -0,0 +1,179 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      tmds_encode_reference.c
+//      Purpose :   Portable C TMDS encoders
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <stdbool.h>
+#include "tmds_encode_reference.h"
+
+#ifdef RUNTIME
+#define __not_in_flash(group)
+#else
+#include "pico.h"                                                                   // The palette encoders run on core 1, from RAM.
+#endif
+
+//
+//      The lookup tables from tmds_encode_custom.S. Each 4 bit group of the input gives two words, each
+//      word being two 10 bit symbols. In the 1bpp table a symbol is a pixel, in the 2bpp table both
+//      symbols of a word are the same pixel at one of four levels.
+//
+static const uint32_t _tmds1bppTable[16][2] = {
+#if !DVI_1BPP_BIT_REVERSE
+    { 0x7fd00, 0x7fd00 }, { 0x7fe00, 0x7fd00 }, { 0xbfd00, 0x7fd00 }, { 0xbfe00, 0x7fd00 },
+    { 0x7fd00, 0x7fe00 }, { 0x7fe00, 0x7fe00 }, { 0xbfd00, 0x7fe00 }, { 0xbfe00, 0x7fe00 },
+    { 0x7fd00, 0xbfd00 }, { 0x7fe00, 0xbfd00 }, { 0xbfd00, 0xbfd00 }, { 0xbfe00, 0xbfd00 },
+    { 0x7fd00, 0xbfe00 }, { 0x7fe00, 0xbfe00 }, { 0xbfd00, 0xbfe00 }, { 0xbfe00, 0xbfe00 }
+#else
+    { 0x7fd00, 0x7fd00 }, { 0x7fd00, 0xbfd00 }, { 0x7fd00, 0x7fe00 }, { 0x7fd00, 0xbfe00 },
+    { 0xbfd00, 0x7fd00 }, { 0xbfd00, 0xbfd00 }, { 0xbfd00, 0x7fe00 }, { 0xbfd00, 0xbfe00 },
+    { 0x7fe00, 0x7fd00 }, { 0x7fe00, 0xbfd00 }, { 0x7fe00, 0x7fe00 }, { 0x7fe00, 0xbfe00 },
+    { 0xbfe00, 0x7fd00 }, { 0xbfe00, 0xbfd00 }, { 0xbfe00, 0x7fe00 }, { 0xbfe00, 0xbfe00 }
+#endif
+};
+
+static const uint32_t _tmds2bppTable[16][2] = {
+    { 0x7f103, 0x7f103 }, { 0x7f103, 0x73d30 }, { 0x7f103, 0xb3e30 }, { 0x7f103, 0xbf203 },
+    { 0x73d30, 0x7f103 }, { 0x73d30, 0x73d30 }, { 0x73d30, 0xb3e30 }, { 0x73d30, 0xbf203 },
+    { 0xb3e30, 0x7f103 }, { 0xb3e30, 0x73d30 }, { 0xb3e30, 0xb3e30 }, { 0xb3e30, 0xbf203 },
+    { 0xbf203, 0x7f103 }, { 0xbf203, 0x73d30 }, { 0xbf203, 0xb3e30 }, { 0xbf203, 0xbf203 }
+};
+
+/**
+ * @brief      Encode using one of the tables, as the assembler loop does. Each
+ *             input word is 8 groups of 4 bits, taken lowest first, or with
+ *             the bit reverse the upper group of each byte first.
+ *
+ * @param      table   Lookup table for this encoder
+ * @param      pixbuf  Input pixels
+ * @param      symbuf  Output symbols
+ * @param[in]  n_pix   Output pixel count
+ */
+static void _TMDSEncode(const uint32_t table[16][2],const uint32_t *pixbuf,uint32_t *symbuf,size_t n_pix) {
+    uint32_t *end = symbuf + n_pix / 2;
+    while (symbuf < end) {
+        uint32_t pixels = *pixbuf++;
+        for (int group = 0;group < 8;group++) {
+            #if !DVI_1BPP_BIT_REVERSE
+            int shift = group * 4;
+            #else
+            int shift = (group ^ 1) * 4;                                            // Swap the groups in each byte.
+            #endif
+            const uint32_t *symbols = table[(pixels >> shift) & 15];
+            *symbuf++ = symbols[0];
+            *symbuf++ = symbols[1];
+        }
+    }
+}
+
+/**
+ * @brief      Encode a line of 1 bit per pixel, one colour component.
+ *
+ * @param[in]  pixbuf  Input pixels, 32 per word
+ * @param      symbuf  Output symbols, 2 per word
+ * @param[in]  n_pix   Output pixel count
+ */
+void tmds_encode_reference_1bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) {
+    _TMDSEncode(_tmds1bppTable,pixbuf,symbuf,n_pix);
+}
+
+/**
+ * @brief      Encode a line of 2 bits per pixel, one colour component, each
+ *             pixel being output twice.
+ *
+ * @param[in]  pixbuf  Input pixels, 16 per word
+ * @param      symbuf  Output symbols, 2 per word
+ * @param[in]  n_pix   Output pixel count
+ */
+void tmds_encode_reference_2bpp(const uint32_t *pixbuf, uint32_t *symbuf, size_t n_pix) {
+    _TMDSEncode(_tmds2bppTable,pixbuf,symbuf,n_pix);
+}
+
+/**
+ * @brief      Encode a line of 4 bit pixels through a palette, each pixel being
+ *             output twice.
+ *
+ * @param[in]  pixbuf   Input pixels, 2 per byte
+ * @param      symbuf   Output symbols, 2 per word
+ * @param[in]  n_pix    Output pixel count
+ * @param[in]  palette  Symbol pairs for this colour component
+ */
+void __not_in_flash("main") tmds_encode_palette_4bpp(const uint8_t *pixbuf, uint32_t *symbuf, size_t n_pix, const uint32_t *palette) {
+    uint32_t *end = symbuf + n_pix / 2;
+    while (symbuf < end) {
+        uint8_t pixels = *pixbuf++;
+        *symbuf++ = palette[pixels >> 4];
+        *symbuf++ = palette[pixels & 15];
+    }
+}
+
+/**
+ * @brief      Encode a line of 8 bit pixels through a palette, each pixel being
+ *             output twice.
+ *
+ * @param[in]  pixbuf   Input pixels, 1 per byte
+ * @param      symbuf   Output symbols, 2 per word
+ * @param[in]  n_pix    Output pixel count
+ * @param[in]  palette  Symbol pairs for this colour component
+ */
+void __not_in_flash("main") tmds_encode_palette_8bpp(const uint8_t *pixbuf, uint32_t *symbuf, size_t n_pix, const uint32_t *palette) {
+    uint32_t *end = symbuf + n_pix / 2;
+    while (symbuf < end) {
+        *symbuf++ = palette[*pixbuf++];
+    }
+}
+
+/**
+ * @brief      Encode one 8 bit value as the DVI 1.0 specification describes,
+ *             tracking the running disparity.
+ *
+ * @param[in]  d        Data byte
+ * @param      balance  Running disparity, updated
+ *
+ * @return     10 bit symbol
+ */
+int tmds_encode_symbol(uint8_t d, int *balance) {
+    int ones = __builtin_popcount(d);
+    bool useXnor = (ones > 4) || (ones == 4 && (d & 1) == 0);
+    int qm = d & 1;                                                                 // Transition minimise
+    for (int i = 1;i < 8;i++) {
+        int bit = ((qm >> (i-1)) ^ (d >> i)) & 1;
+        qm |= (useXnor ? bit ^ 1 : bit) << i;
+    }
+    if (!useXnor) qm |= 0x100;
+    int n1 = __builtin_popcount(qm & 0xFF),n0 = 8-n1;
+    int symbol;
+    if (*balance == 0 || n1 == n0) {                                                // DC balance
+        symbol = ((qm & 0x100) ? 0x100 | (qm & 0xFF) : 0x200 | (~qm & 0xFF));
+        *balance += (qm & 0x100) ? n1-n0 : n0-n1;
+    } else if ((*balance > 0 && n1 > n0) || (*balance < 0 && n0 > n1)) {
+        symbol = 0x200 | (qm & 0x100) | (~qm & 0xFF);
+        *balance += ((qm & 0x100) ? 2 : 0) + n0-n1;
+    } else {
+        symbol = (qm & 0x100) | (qm & 0xFF);
+        *balance += ((qm & 0x100) ? 0 : -2) + n1-n0;
+    }
+    return symbol;
+}
+
+/**
+ * @brief      Get the symbol pair for a level. The level is followed by the
+ *             level with bit 0 flipped, which for every 8 bit value brings the
+ *             running disparity back to zero, so pairs can be output in any
+ *             order. This is how the 1bpp and 2bpp tables were made.
+ *
+ * @param[in]  level  Colour component level, 0-255
+ *
+ * @return     Word of two 10 bit symbols.
+ */
+uint32_t tmds_encode_balanced_pair(uint8_t level) {
+    int balance = 0;
+    uint32_t s0 = tmds_encode_symbol(level,&balance);
+    uint32_t s1 = tmds_encode_symbol(level ^ 1,&balance);
+    return s0 | (s1 << 10);
+}
@@ -0,0 +1,66 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :       vsync.c
+//      Purpose :    Frame count, wait for vertical sync and the vertical sync callback
+//      Date :       17th October 2026
+//      Author :     Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include "dvi_module.h"
+
+static DVIVSYNCFUNCTION vsyncCallback = NULL;                                       // Called at vsync, if set.
+static uint32_t lastCallbackFrame = 0;                                              // Frame count it was last called with.
+
+/**
+ * @brief      Get the number of frames scanned out. This is counted by core 1
+ *             (or the runtime's display) as it passes the last line.
+ *
+ * @return     Frame count.
+ */
+uint32_t DVIGetFrameCount(void) {
+    return __atomic_load_n(&dvi_frameCount,__ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief      Update function, calls the callback if there has been a vertical
+ *             sync since it was last called.
+ */
+static void _DVIVSyncUpdate(void) {
+    uint32_t frame = DVIGetFrameCount();
+    if (vsyncCallback != NULL && frame != lastCallbackFrame) {
+        lastCallbackFrame = frame;
+        (*vsyncCallback)(frame);
+    }
+}
+
+/**
+ * @brief      Wait for the next vertical sync, updating in the background.
+ *             Drawing straight after this has the whole of the vertical blank
+ *             and the start of the frame before the scanout gets to it.
+ */
+void DVIWaitVSync(void) {
+    uint32_t frame = DVIGetFrameCount();
+    while (DVIGetFrameCount() == frame && COMAppRunning()) {
+        COMUpdate();
+    }
+    _DVIVSyncUpdate();                                                              // Callback before returning, if not already.
+}
+
+/**
+ * @brief      Set the function called at each vertical sync. This is called on
+ *             core 0 from COMUpdate(), so it can draw, not from core 1.
+ *
+ * @param[in]  callback  Function to call, NULL to stop.
+ */
+void DVISetVSyncCallback(DVIVSYNCFUNCTION callback) {
+    static bool isRegistered = false;
+    lastCallbackFrame = DVIGetFrameCount();                                         // Called from the next one.
+    vsyncCallback = callback;
+    if (!isRegistered) {                                                            // Only add the update function once.
+        isRegistered = true;
+        COMAddUpdateFunction(_DVIVSyncUpdate);
+    }
+}
@@ -11,14 +11,37 @@
 // *******************************************************************************************
  
 #include "graphics_module.h"
+#include "graphics_module_local.h"
 
 static void generalTest(void);
+//
+//      Build with GRAPHICS_BENCHMARK defined (e.g. cmake -DCMAKE_C_FLAGS=-DGRAPHICS_BENCHMARK) to check the
+//      drawing operators against the pixels read back, and time them, before the tests.
+//
+#ifdef GRAPHICS_BENCHMARK
+static void operatorCheck(void);
+static void operatorBenchmark(void);
+//
+//      The drawing benchmark is timed in microseconds, with the runtime's clock or the RP2350's timer.
+//
+#ifdef RUNTIME
+uint64_t SYSClockMicroseconds(void);
+bool SYSIsVirtualClock(void);
+#define BENCHMARKCLOCK() SYSClockMicroseconds()
+#else
+#define BENCHMARKCLOCK() time_us_64()
+#endif
+#endif
 
 int MAINPROGRAM() {
     uint32_t x,y;
     DVIInitialise();
     VDUInitialise();
 
+    #ifdef GRAPHICS_BENCHMARK
+    operatorCheck();
+    operatorBenchmark();
+    #endif
     generalTest();
 
     VDUWrite(24);VDUWriteWord(50);VDUWriteWord(50);VDUWriteWord(1230);VDUWriteWord(900);
@@ -38,6 +61,91 @@ int MAINPROGRAM() {
         COMUpdate();
     }   }
 
+#ifdef GRAPHICS_BENCHMARK
+/**
+ * @brief      Check points and horizontal lines for every GCOL action against
+ *             the pixels read back, in every mode with pixels, over random
+ *             framebuffer contents.
+ */
+static void operatorCheck(void) {
+    static int before[FRAME_WIDTH];
+    int checks = 0,errors = 0;
+    for (int mode = 0;mode < DVI_MODE_COUNT;mode++) {
+        VDUWrite(22);VDUWrite(mode);
+        DVIMODEINFO *dm = DVIGetModeInformation();
+        if (dm->cellHeight != 0) continue;                                          // Text modes have no pixels.
+        int colours = dm->isChunky ? (1 << dm->bitPlaneDepth) : (dm->bitPlaneDepth == 2) ? 64 : 8;
+        for (int i = 0;i < VIDEO_BYTES;i++) framebuf[i] = rand();
+        for (int test = 0;test < 2000;test++) {
+            int action = rand() % 5,colour = rand() % colours,y = rand() % dm->height;
+            int x1 = rand() % (dm->width+40)-20,x2 = rand() % (dm->width+40)-20;    // Span, partly off the display.
+            if (test % 2 == 0) x2 = x1 = rand() % dm->width;                        // Point.
+            for (int x = 0;x < dm->width;x++) before[x] = VDUAReadPixel(x,y,true);
+            VDUASetActionColour(action,colour);
+            if (x1 == x2) {
+                VDUAPlot(x1,y);
+            } else {
+                VDUAHorizLine(x1,x2,y);
+            }
+            int xFrom = max(min(x1,x2),vc.gw.xLeft),xTo = min(max(x1,x2),vc.gw.xRight);
+            for (int x = 0;x < dm->width;x++) {
+                int expect = before[x];
+                if (x >= xFrom && x <= xTo) {
+                    switch(action) {
+                        case 0: expect = colour;break;
+                        case 1: expect |= colour;break;
+                        case 2: expect &= colour;break;
+                        case 3: expect ^= colour;break;
+                        case 4: expect ^= colours-1;break;
+                    }
+                }
+                checks++;
+                if (VDUAReadPixel(x,y,true) != expect) {
+                    if (errors++ < 10) LOG("Mode %d GCOL %d,%d from %d to %d line %d : pixel %d is %d not %d",
+                                           mode,action,colour,x1,x2,y,x,VDUAReadPixel(x,y,true),expect);
+                }
+            }
+        }
+    }
+    LOG("Drawing check : %d pixels, %d wrong",checks,errors);
+}
+
+/**
+ * @brief      Time the drawing operators for each GCOL action in the 8, 64 and
+ *             256 colour modes : single points, horizontal lines across the
+ *             display and diagonal lines. These call the atomic functions
+ *             directly, so the VDU command handling is not timed.
+ */
+static void operatorBenchmark(void) {
+    static const int modes[] = { MODE_640_480_8,MODE_320_240_64,MODE_320_240_256 };
+    #ifdef RUNTIME
+    if (SYSIsVirtualClock()) {                                                      // Would time nothing at all.
+        LOG("Drawing benchmark skipped, it needs the real clock");
+        return;
+    }
+    #endif
+    for (int m = 0;m < 3;m++) {
+        VDUWrite(22);VDUWrite(modes[m]);
+        DVIMODEINFO *dm = DVIGetModeInformation();
+        int w = dm->width,h = dm->height;
+        for (int action = 0;action < 5;action++) {
+            VDUASetActionColour(action,5);
+            uint64_t start = BENCHMARKCLOCK();                                      // Points
+            for (int i = 0;i < 200000;i++) VDUAPlot((i * 7) % w,(i * 13) % h);
+            uint32_t points = BENCHMARKCLOCK()-start;
+            start = BENCHMARKCLOCK();                                               // Horizontal lines
+            for (int i = 0;i < 20000;i++) VDUAHorizLine(i % 7,w-1-i % 5,i % h);
+            uint32_t spans = BENCHMARKCLOCK()-start;
+            start = BENCHMARKCLOCK();                                               // Diagonal lines
+            for (int i = 0;i < 2000;i++) VDUALine((i * 4) % w,0,w-1-(i * 4) % w,h-1);
+            uint32_t lines = BENCHMARKCLOCK()-start;
+            LOG("Mode %d GCOL %d : 200000 points %u us, 20000 horizontal lines %u us, 2000 lines %u us",
+                                                            modes[m],action,points,spans,lines);
+        }
+    }
+}
+#endif
+
 /**
  * @brief      General test procedure
  */
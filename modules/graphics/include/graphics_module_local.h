@@ -62,6 +62,7 @@ void VDUResetTextWindow(void);
 void VDUSetTextWindow(int x1,int y1,int x2,int y2);
 void VDUSetGraphicsWindow(int x1,int y1,int x2,int y2);
 void VDUSetDefaultGraphicColour(void);
+void VDUDefineLogicalColour(int logical,int physical,int r,int g,int b);
 void VDUResetGraphicsWindow(void);
 void VDUPlotDispatch(int cmd,int *xCoord,int *yCoord);                                           
 void VDUClearGraphicsWindow(void);
@@ -98,6 +99,13 @@ void VDUDisableCursor(void);
 void VDUScrollV(int yFrom,int yTo,int yTarget,int yClear,int xLeft, int xRight);
 void VDUScrollH(int xLeft,int xRight,int dir,int yTop, int yBottom);
 
+void VDUCellRender(int x,int y,int c);
+void VDUCellScrollV(int yFrom,int yTo,int yTarget,int yClear,int xLeft,int xRight);
+void VDUCellScrollH(int xLeft,int xRight,int dir,int yTop,int yBottom);
+void VDUCellCopy(int xFrom,int yFrom,int xTo,int yTo);
+void VDUCellCursor(void);
+uint8_t VDUCellRead(int x,int y);
+
 void VDUResetTextEndMarkers(void);                                                      
 void VDUScrollTextEndMarkers(int dir);
 void VDUSetTextEndMarker(int y);
@@ -0,0 +1,122 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      cells.c
+//      Purpose :   Text Atomic Functions for the character cell modes
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include "graphics_module.h"
+#include "graphics_module_local.h"
+
+//
+//      In the text modes the display is one plane of 16 bit cells, character and colours, which the scanout
+//      draws through the font. These are the text mode versions of the functions in text.c and cursor.c,
+//      which call them ; the graphics functions draw nothing in these modes.
+//
+
+/**
+ * @brief      Write a character cell in the current colours.
+ *
+ * @param[in]  x     x Coordinate
+ * @param[in]  y     y Coordinate
+ * @param[in]  c     Character to write
+ */
+void VDUCellRender(int x,int y,int c) {
+    DVIMODEINFO *dmi = DVIGetModeInformation();
+    *DVIGetCellAddress(dmi,x,y) = DVI_CELL(c,vc.fgCol,vc.bgCol);
+    DVIMarkDirty(y*vc.textHeight,(y+1)*vc.textHeight-1);
+}
+
+/**
+ * @brief      Copy rows of cells, blank the bottom or top row. Rows can wrap
+ *             round the plane because of the scroll offset, so each row of the
+ *             window is copied on its own.
+ *
+ * @param[in]  yFrom    Copy from this row
+ * @param[in]  yTo      To this row
+ * @param[in]  yTarget  Until this is reached.
+ * @param[in]  yClear   Row to clear
+ * @param[in]  xLeft    left edge of window to scroll.
+ * @param[in]  xRight   right edge of window to scroll.
+ */
+void VDUCellScrollV(int yFrom,int yTo,int yTarget,int yClear,int xLeft,int xRight) {
+    DVIMODEINFO *dmi = DVIGetModeInformation();
+    int dir = (yFrom > yTarget) ? -1 : 1;                                           // How From and to are adjusted.
+    int rows = dmi->height / dmi->cellHeight;
+    int copySize = (xRight-xLeft+1) * sizeof(uint16_t);                             // Bytes in a row of the window.
+    bool isComplete = false;
+    while (!isComplete) {
+        if (yFrom >= 0 && yTo >= 0 && yFrom < rows && yTo < rows) {
+            memcpy(DVIGetCellAddress(dmi,xLeft,yTo),DVIGetCellAddress(dmi,xLeft,yFrom),copySize);
+            DVIMarkDirty(yTo*vc.textHeight,(yTo+1)*vc.textHeight-1);
+        }
+        if (yFrom == yTarget) isComplete = true;                                    // Done the last one ?
+        yFrom += dir;yTo += dir;
+    }
+    for (int x = vc.tw.xLeft;x <= vc.tw.xRight;x++) {                               // Blank the new row.
+        VDUCellRender(x,yClear,' ');
+    }
+}
+
+/**
+ * @brief      Scroll rows of cells horizontally, blank the left or right end.
+ *
+ * @param[in]  xLeft    Left edge of window to scroll
+ * @param[in]  xRight   Right edge of window to scroll
+ * @param[in]  dir      Direction -1 = left, +1 = right.
+ * @param[in]  yTop     Top edge of window to scroll.
+ * @param[in]  yBottom  Bottom edge of window to scroll.
+ */
+void VDUCellScrollH(int xLeft,int xRight,int dir,int yTop,int yBottom) {
+    DVIMODEINFO *dmi = DVIGetModeInformation();
+    int xFrom = (dir < 0) ? xLeft+1 : xLeft;                                        // Cells to copy from and to.
+    int xTo = (dir < 0) ? xLeft : xLeft+1;
+    for (int y = yTop;y <= yBottom;y++) {
+        uint16_t *row = DVIGetCellAddress(dmi,0,y);
+        memmove(row+xTo,row+xFrom,(xRight-xLeft) * sizeof(uint16_t));
+        VDUCellRender(dir < 0 ? xRight:xLeft,y,' ');                                // Blank the new column.
+    }
+}
+
+/**
+ * @brief      Copy a character cell.
+ *
+ * @param[in]  xFrom  source x
+ * @param[in]  yFrom  source y
+ * @param[in]  xTo    dest x
+ * @param[in]  yTo    dest y
+ */
+void VDUCellCopy(int xFrom,int yFrom,int xTo,int yTo) {
+    DVIMODEINFO *dmi = DVIGetModeInformation();
+    *DVIGetCellAddress(dmi,xTo,yTo) = *DVIGetCellAddress(dmi,xFrom,yFrom);
+    DVIMarkDirty(yTo*vc.textHeight,(yTo+1)*vc.textHeight-1);
+}
+
+/**
+ * @brief      Draw or erase the cursor by swapping the colours of its cell.
+ *             Doing it twice puts it back.
+ */
+void VDUCellCursor(void) {
+    DVIMODEINFO *dmi = DVIGetModeInformation();
+    int y = vc.yCursor+vc.tw.yTop;
+    uint16_t *cell = DVIGetCellAddress(dmi,vc.xCursor+vc.tw.xLeft,y);
+    *cell = DVI_CELL(DVI_CELL_CHAR(*cell),DVI_CELL_BG(*cell),DVI_CELL_FG(*cell));
+    DVIMarkDirty(y*vc.textHeight,(y+1)*vc.textHeight-1);
+}
+
+/**
+ * @brief      Read the character in a cell.
+ *
+ * @param[in]  x     x Coordinate
+ * @param[in]  y     y Coordinate
+ *
+ * @return     character code, 0 if it is not a displayable one.
+ */
+uint8_t VDUCellRead(int x,int y) {
+    uint8_t c = DVI_CELL_CHAR(*DVIGetCellAddress(DVIGetModeInformation(),x,y));
+    return (c < ' ' || c == 0x7F) ? 0 : c;
+}
@@ -20,14 +20,18 @@
  */
 void VDUDrawCursor(bool isVisible) {
     DVIMODEINFO *dmi = DVIGetModeInformation();            
-    bool is64Bit = (dmi->bitPlaneDepth == 2);
+    if (dmi->cellHeight != 0) {                                                     // Text mode, swap the cell's colours.
+        VDUCellCursor();
+        return;
+    }
+    int bytesPerCharacter = dmi->bitPlaneDepth;                                     // 8 pixels of this depth.
     for (int plane = 0;plane < dmi->bitPlaneCount;plane++) {        
-        uint8_t *p = dmi->bitPlane[plane] + (dmi->bytesPerLine * vc.textHeight * (vc.yCursor+vc.tw.yTop)) + ((vc.xCursor+vc.tw.xLeft) * (is64Bit ? 2 : 1));
         for (int y = 0;y < vc.textHeight;y++) {
-            *p ^= 0xFF;if (is64Bit) *(p+1) ^= 0xFF;
-            p += dmi->bytesPerLine;
+            uint8_t *p = DVIGetLineAddress(dmi,plane,vc.textHeight * (vc.yCursor+vc.tw.yTop) + y) + ((vc.xCursor+vc.tw.xLeft) * bytesPerCharacter);
+            for (int i = 0;i < bytesPerCharacter;i++) p[i] ^= 0xFF;
         }
     }
+    DVIMarkDirty(vc.textHeight * (vc.yCursor+vc.tw.yTop),vc.textHeight * (vc.yCursor+vc.tw.yTop+1)-1);
 }
 
 
@@ -13,11 +13,12 @@
 #include "graphics_module.h"
 #include "graphics_module_local.h"
 
-static inline void _VDUDrawBitmap3(void);
-static inline void _VDUDrawBitmap6(void);
+static inline uint8_t _VDUChunkyFill(void);
 static inline void _VDUDrawBitmap(void);
 static int _VDUAReadPixelDirect(void);
 static void _VDUAValidate(bool isValid);
+static void _VDUSetPatterns(void);
+static void _VDUSpanPlane(uint8_t *p,int bytes,uint8_t firstMask,uint8_t lastMask,uint32_t andPattern,uint32_t xorPattern);
 
 static DVIMODEINFO *_dmi = NULL;                                                    // Current mode information.
 
@@ -28,11 +29,18 @@ static uint8_t *pl0,*pl1,*pl2;
 static uint8_t colour = 7;                                                          // Drawing colour
 static uint8_t action = 0;                                                          // What to do.
 static int controlBits = 0;                                                         // Controls various aspects of atomic drawing
+static uint32_t planeAnd[3],planeXor[3];                                            // Drawing patterns for each plane.
+static int patternKey = -1;                                                         // Action, colour and depth they are for.
 
 #define OFFWINDOWH(x)   ((x) < vc.gw.xLeft || (x) > vc.gw.xRight)
 #define OFFWINDOWV(y)   ((y) < vc.gw.yBottom || (y) > vc.gw.yTop)
 #define OFFWINDOW(x,y)  (OFFWINDOWH(x) || OFFWINDOWV(y))
 
+#define TOPMASK(depth)  ((0xFF << (8-(depth))) & 0xFF)                               // Mask for the leftmost pixel in a byte.
+#define LOWMASK(depth)  (0xFF >> (8-(depth)))                                       // Mask for the rightmost pixel in a byte.
+
+#define MARKDIRTY(y1,y2) DVIMarkDirty(_dmi->height-1-(y2),_dmi->height-1-(y1))  // Mark physical rows y1..y2 (y1 <= y2) as changed.
+
 /**
  * @brief      Set Action and Colour (from GCOL)
  *
@@ -41,6 +49,7 @@ static int controlBits = 0;
  */
 void VDUASetActionColour(int act,int col) {
     action = act;colour = col;
+    patternKey = -1;                                                                // Patterns need working out again.
 }
 
 /**
@@ -60,18 +69,15 @@ void VDUASetControlBits(int c) {
 static void _VDUAValidate(bool isValid) {
     dataValid = false;
     if (!isValid && OFFWINDOW(xPixel,yPixel)) return;                               // No, we can't do anything.
+    if (_dmi->cellHeight != 0) return;                                              // No pixels in the text modes.
 
-    int offset;
-    if (_dmi->bitPlaneDepth == 2) {
-            offset = (xPixel >> 2) + ((_dmi->height-1-yPixel) * _dmi->bytesPerLine);// Work out the offset on the bitmap planes.
-            bitMask = (0xC0 >> (2*(xPixel & 3)));                                   // Work out the bitmask for the current pixel.
-    } else {
-            offset = (xPixel >> 3) + ((_dmi->height-1-yPixel) * _dmi->bytesPerLine);// Work out the offset on the bitmap planes.
-            bitMask = (0x80 >> (xPixel & 7));                                       // Work out the bitmask for the current pixel.
-    }
-    pl0 = _dmi->bitPlane[0]+offset;                                                 // Set up bitmap plane pointers.
-    pl1 = _dmi->bitPlane[1]+offset;
-    pl2 = _dmi->bitPlane[2]+offset;
+    int depth = _dmi->bitPlaneDepth;                                                // Bits per pixel in each plane, 1,2,4 or 8
+    int pixelsPerByte = 8 / depth;
+    int line = _dmi->height-1-yPixel;                                               // Display line, before the scroll offset.
+    bitMask = TOPMASK(depth) >> (depth * (xPixel % pixelsPerByte));                 // Work out the bitmask for the current pixel.
+    pl0 = DVIGetLineAddress(_dmi,0,line) + xPixel / pixelsPerByte;                  // Set up bitmap plane pointers.
+    pl1 = _dmi->isChunky ? pl0 : DVIGetLineAddress(_dmi,1,line) + xPixel / pixelsPerByte; // Chunky modes only have one.
+    pl2 = _dmi->isChunky ? pl0 : DVIGetLineAddress(_dmi,2,line) + xPixel / pixelsPerByte;
 
     dataValid = true;                                                               // We have valid data
 }
@@ -84,13 +90,20 @@ static void _VDUAValidate(bool isValid) {
  */
 void VDUAPlot(int x,int y) {
     _dmi = DVIGetModeInformation();                                                 // Get mode information
+    _VDUSetPatterns();
     xPixel = x;yPixel = y;                                                          // Update the pixel positions.
     _VDUAValidate(false);                                                           // Validate the position.
-    if (dataValid) _VDUDrawBitmap();                                                // Draw pixel if valid.
+    if (dataValid) {                                                                // Draw pixel if valid.
+        _VDUDrawBitmap();
+        MARKDIRTY(y,y);
+    }
 }
 
 /**
- * @brief      Draw horizontal line
+ * @brief      Draw horizontal line. This is a span fill : each plane is done
+ *             in one go, the bytes at the ends with masks and the middle a 32
+ *             bit word at a time, using patterns worked out for the action and
+ *             colour.
  *
  * @param[in]  x1      The x1 coordinate
  * @param[in]  x2      The x2 coordinate
@@ -98,40 +111,106 @@ void VDUAPlot(int x,int y) {
  */
 void VDUAHorizLine(int x1,int x2,int y) {
     _dmi = DVIGetModeInformation();                                                 // Get mode information
-    int ppb = _dmi->bitPlaneDepth==2 ? 4 : 8;
+    if (_dmi->cellHeight != 0) return;                                              // No pixels in the text modes.
     if (OFFWINDOWV(y)) return;                                                      // Vertically out of range => no line.
     if (x1 >= x2) { int n = x1;x1 = x2;x2 = n; }                                    // Sort the x coordinates into order.
-    if (x2 < vc.gw.xLeft || x1 >= vc.gw.xRight) return;                             // On screen area (e.g. lower off right, higher off left)
+    if (x2 < vc.gw.xLeft || x1 > vc.gw.xRight) return;                              // On screen area (e.g. lower off right, higher off left)
     x1 = max(x1,vc.gw.xLeft);x2 = min(x2,vc.gw.xRight);                             // Trim horizontal line to port.
-    xPixel = x1;yPixel = y;dataValid = false;                                       // First pixel.
-    _VDUAValidate(false);
-    int pixelCount = x2-x1+1;                                                       // Pixels to draw
 
-    //
-    //      First, we go to a byte boundary, if there are enough pixels.
-    //
-    while (pixelCount > 0 && (bitMask & 0x80) == 0) {                               // Shift until reached byte boundary
-        _VDUDrawBitmap();
-        VDUARight();
-        pixelCount--;
+    int depth = _dmi->bitPlaneDepth;
+    int pixelsPerByte = 8 / depth;
+    int line = _dmi->height-1-y;                                                    // Display line, before the scroll offset.
+    int first = x1 / pixelsPerByte,last = x2 / pixelsPerByte;                       // Bytes the span starts and ends in.
+    uint8_t firstMask = 0xFF >> (depth * (x1 % pixelsPerByte));                     // From x1 to the end of its byte.
+    uint8_t lastMask = 0xFF << (8 - depth * (x2 % pixelsPerByte + 1));              // From the start of its byte to x2.
+    _VDUSetPatterns();
+    for (int p = 0;p < _dmi->bitPlaneCount;p++) {
+        _VDUSpanPlane(DVIGetLineAddress(_dmi,p,line)+first,last-first+1,firstMask,lastMask,planeAnd[p],planeXor[p]);
     }
-    //
-    //      While on a byte boundary, if there are enough pixels, do whole bytes. I did consider doing it in longs at this point.
-    //
-    while (pixelCount >= ppb) {                                                     // Now do it byte chunks.
-        bitMask = 0xFF;_VDUDrawBitmap();                                            // This does the line in whole bytes.
-        pl0++;pl1++;pl2++;                                                          // Advance pointer
-        pixelCount -= ppb;                                                          // 8 fewer pixels
-        xPixel += ppb;                                                              // Keep the position up to date, doesn't really matter.
+    MARKDIRTY(y,y);
+}
+
+/**
+ * @brief      Work out the drawing patterns. Every action is the same
+ *             operation, (byte AND pattern) XOR pattern, so for each plane
+ *             this works out the two patterns with the colour's bits in every
+ *             pixel of a word. Pixels and spans only need a mask on top, so
+ *             there is no switch on the action or test of the colour bits as
+ *             they are drawn. Only done when the action, colour or mode's
+ *             depth change.
+ */
+static void _VDUSetPatterns(void) {
+    int key = (action << 16) | (colour << 8) | (_dmi->isChunky ? 0x80 : 0) | _dmi->bitPlaneDepth;
+    if (key == patternKey) return;
+    patternKey = key;
+    for (int p = 0;p < 3;p++) {
+        uint32_t pattern;                                                           // Colour bits for every pixel in this plane.
+        if (_dmi->isChunky) {
+            if (p > 0) {                                                            // Only one plane, pl1 and pl2 are pl0, so
+                planeAnd[p] = 0xFFFFFFFF;planeXor[p] = 0;                           // the others leave it alone.
+                continue;
+            }
+            pattern = (uint32_t)_VDUChunkyFill() * 0x01010101u;
+        } else if (_dmi->bitPlaneDepth == 2) {                                      // 64 colours, the two bits of each pixel.
+            pattern = ((colour & (1 << p)) ? 0xAAAAAAAA : 0) | ((colour & (8 << p)) ? 0x55555555 : 0);
+        } else {
+            pattern = (colour & (1 << p)) ? 0xFFFFFFFF : 0;
+        }
+        switch(action) {
+            case 0:                                                                 // Standard draw
+                planeAnd[p] = 0;planeXor[p] = pattern;break;
+            case 1:                                                                 // OR Draw
+                planeAnd[p] = ~pattern;planeXor[p] = pattern;break;
+            case 2:                                                                 // AND Draw
+                planeAnd[p] = pattern;planeXor[p] = 0;break;
+            case 3:                                                                 // XOR Draw
+                planeAnd[p] = 0xFFFFFFFF;planeXor[p] = pattern;break;
+            case 4:                                                                 // Invert Draw
+                planeAnd[p] = 0xFFFFFFFF;planeXor[p] = 0xFFFFFFFF;break;
+            default:                                                                // Anything else does nothing.
+                planeAnd[p] = 0xFFFFFFFF;planeXor[p] = 0;break;
+        }
     }
-    //
-    //      Do any remaining single pixels
-    //
-    bitMask = _dmi->bitPlaneDepth == 2? 0xC0 : 0x80;                                // We know we are on a byte boundary
-    while (pixelCount-- > 0) {                                                      // Draw any remaining pixels.
-        _VDUDrawBitmap();
-        VDUARight();
+}
+
+/**
+ * @brief      Fill a span of one plane. The end bytes only change the pixels
+ *             in their masks, the bytes between are done a word at a time once
+ *             the address is aligned, or with memset() when drawing. The
+ *             patterns are the same in every byte.
+ *
+ * @param      p           First byte
+ * @param[in]  bytes       Number of bytes, at least 1
+ * @param[in]  firstMask   Pixels to change in the first byte
+ * @param[in]  lastMask    Pixels to change in the last byte
+ * @param[in]  andPattern  AND pattern
+ * @param[in]  xorPattern  XOR pattern
+ */
+static void _VDUSpanPlane(uint8_t *p,int bytes,uint8_t firstMask,uint8_t lastMask,uint32_t andPattern,uint32_t xorPattern) {
+    uint8_t andByte = andPattern,xorByte = xorPattern;
+    if (bytes == 1) {                                                               // Starts and ends in the same byte.
+        firstMask &= lastMask;
+        *p = (*p & (andByte | ~firstMask)) ^ (xorByte & firstMask);
+        return;
+    }
+    *p = (*p & (andByte | ~firstMask)) ^ (xorByte & firstMask);p++;                 // Ragged left end.
+    int middle = bytes-2;
+    if (andPattern == 0) {                                                          // Just drawing, so the middle is a fill.
+        memset(p,xorByte,middle);
+        p += middle;middle = 0;
+    }
+    while (middle > 0 && ((uintptr_t)p & 3) != 0) {                                 // Bytes up to a word boundary.
+        *p = (*p & andByte) ^ xorByte;p++;middle--;
     }
+    uint32_t *w = (uint32_t *)p;
+    while (middle >= 4) {                                                           // Whole words
+        *w = (*w & andPattern) ^ xorPattern;w++;middle -= 4;
+    }
+    p = (uint8_t *)w;
+    while (middle-- > 0) {                                                          // Bytes after the last word
+        *p = (*p & andByte) ^ xorByte;p++;
+    }
+    *p = (*p & (andByte | ~lastMask)) ^ (xorByte & lastMask);                       // Ragged right end.
 }
 
 /**
@@ -144,6 +223,7 @@ void VDUAHorizLine(int x1,int x2,int y) {
  */
 void VDUAVertLine(int x,int y1,int y2) {
     _dmi = DVIGetModeInformation();                                                 // Get mode information
+    _VDUSetPatterns();
     if (OFFWINDOWH(x)) return;                                                      // Off screen.
     if (y1 > y2) { int n = y1;y1 = y2;y2 = n; }                                     // Sort y coordinates
     if (y2 < vc.gw.yBottom || y1 >= vc.gw.yTop) return;                             // Wholly off top or bottom.
@@ -154,6 +234,20 @@ void VDUAVertLine(int x,int y1,int y2) {
     while (pixelCount-- > 0) {                                                      // Shift until reached byte boundary
         _VDUDrawBitmap();VDUAUp();
     }
+    MARKDIRTY(y1,y2);
+}
+
+/**
+ * @brief      Move the pointers to the other end of the planes when moving up
+ *             or down goes past the first or last line. With a scroll offset
+ *             the display wraps round in the planes.
+ *
+ * @param[in]  bytes  Byte offset to add to each pointer
+ */
+static void _VDUAWrapLines(int bytes) {
+    pl0 += bytes;
+    pl1 = _dmi->isChunky ? pl0 : pl1 + bytes;
+    pl2 = _dmi->isChunky ? pl0 : pl2 + bytes;
 }
 
 /**
@@ -164,6 +258,7 @@ void VDUAUp(void) {
     pl0 -= _dmi->bytesPerLine;                                                      // Shift pointers to next line up.
     pl1 -= _dmi->bytesPerLine;
     pl2 -= _dmi->bytesPerLine;
+    if (pl0 < _dmi->bitPlane[0]) _VDUAWrapLines(_dmi->bitPlaneSize);                // Off the start of the plane.
     if (dataValid) dataValid = (yPixel <= vc.gw.yTop);                              // Still in window
 }
 
@@ -175,6 +270,7 @@ void VDUADown(void) {
     pl0 += _dmi->bytesPerLine;                                                      // Shift pointers to next line down
     pl1 += _dmi->bytesPerLine;
     pl2 += _dmi->bytesPerLine;
+    if (pl0 >= _dmi->bitPlane[0]+_dmi->bitPlaneSize) _VDUAWrapLines(-_dmi->bitPlaneSize); // Off the end of the plane.
     if (dataValid) dataValid = (yPixel >= vc.gw.yBottom);                           // Still in window
 }
 
@@ -183,18 +279,10 @@ void VDUADown(void) {
  */
 void VDUALeft(void) {
     xPixel--;                                                                       // Pixel left
-    if (_dmi->bitPlaneDepth == 2) {
-        bitMask = (bitMask << 2) & 0xFF;                                            // Shift bitmap left
-        if (bitMask == 0) {                                                         // Off the left side.
-            bitMask = 0x03;                                                         // Reset bitmap
-            pl0--;pl1--;pl2--;                                                      // Bump plane pointers
-        }
-    } else {
-        bitMask = (bitMask << 1) & 0xFF;                                            // Shift bitmap left
-        if (bitMask == 0) {                                                         // Off the left side.
-            bitMask = 0x01;                                                         // Reset bitmap
-            pl0--;pl1--;pl2--;                                                      // Bump plane pointers
-        }
+    bitMask = (bitMask << _dmi->bitPlaneDepth) & 0xFF;                              // Shift bitmap left
+    if (bitMask == 0) {                                                             // Off the left side.
+        bitMask = LOWMASK(_dmi->bitPlaneDepth);                                     // Reset bitmap
+        pl0--;pl1--;pl2--;                                                          // Bump plane pointers
     }
     if (dataValid) dataValid = (xPixel >= vc.gw.xLeft);                             // Still in window
 }
@@ -204,18 +292,10 @@ void VDUALeft(void) {
  */
 void VDUARight(void) {
     xPixel++;                                                                       // Pixel right
-    if (_dmi->bitPlaneDepth == 2) {
-        bitMask >>= 2;                                                              // Shift bitmap right
-        if (bitMask == 0) {                                                         // Off the right side.
-            bitMask = 0xC0;                                                         // Reset bitmap
-            pl0++;pl1++;pl2++;                                                      // Bump plane pointers
-        }
-    } else {
-        bitMask >>= 1;                                                              // Shift bitmap right
-        if (bitMask == 0) {                                                         // Off the right side.
-            bitMask = 0x80;                                                         // Reset bitmap
-            pl0++;pl1++;pl2++;                                                      // Bump plane pointers
-        }
+    bitMask >>= _dmi->bitPlaneDepth;                                                // Shift bitmap right
+    if (bitMask == 0) {                                                             // Off the right side.
+        bitMask = TOPMASK(_dmi->bitPlaneDepth);                                     // Reset bitmap
+        pl0++;pl1++;pl2++;                                                          // Bump plane pointers
     }
     if (dataValid) dataValid = (xPixel < vc.gw.xRight);                             // Still in window
 }
@@ -245,6 +325,7 @@ void VDUALine(int x0, int y0, int x1, int y1) {
     }
 
     _dmi = DVIGetModeInformation();                                                 // Get mode information
+    _VDUSetPatterns();
 
     int dx = abs(x1 - x0);
     int sx = x0 < x1 ? 1 : -1;
@@ -277,93 +358,29 @@ void VDUALine(int x0, int y0, int x1, int y1) {
         if (!dataValid) _VDUAValidate(false);
         if (dataValid & drawDot) _VDUDrawBitmap();
     }
+    MARKDIRTY(min(y0,y1),max(y0,y1));
 }
 
 /**
- * @brief      Draw bitmap dispatched
+ * @brief      Draw the current pixel, with the patterns for the action and
+ *             colour masked to it. Chunky modes have pl1 and pl2 the same as
+ *             pl0, with patterns that leave it alone.
  */
 static inline void _VDUDrawBitmap(void) {
     if (!dataValid) return;                                                         // Not valid drawing.
-    if (_dmi->bitPlaneDepth == 2) {
-        _VDUDrawBitmap6();
-    } else {
-        _VDUDrawBitmap3();
-    }
-}
-
-/**
- * @brief      Draw bitmap for 3 plane
- */
-static inline void _VDUDrawBitmap3(void) {
-
-    switch(action) {
-
-        case 0:                                                                     // Standard draw
-            *pl0 = ((*pl0) & (~bitMask)) | ((colour & 1) ? bitMask:0);
-            *pl1 = ((*pl1) & (~bitMask)) | ((colour & 2) ? bitMask:0);
-            *pl2 = ((*pl2) & (~bitMask)) | ((colour & 4) ? bitMask:0);
-            break;
-        case 1:                                                                     // OR Draw
-            *pl0 |= ((colour & 1) ? bitMask:0);
-            *pl1 |= ((colour & 2) ? bitMask:0);
-            *pl2 |= ((colour & 4) ? bitMask:0);
-            break;
-        case 2:                                                                     // AND Draw
-            *pl0 &= ((colour & 1) ? bitMask:0);
-            *pl1 &= ((colour & 2) ? bitMask:0);
-            *pl2 &= ((colour & 4) ? bitMask:0);
-            break;
-        case 3:                                                                     // XOR Draw
-            *pl0 ^= ((colour & 1) ? bitMask:0);
-            *pl1 ^= ((colour & 2) ? bitMask:0);
-            *pl2 ^= ((colour & 4) ? bitMask:0);
-            break;
-        case 4:                                                                     // Invert Draw
-            *pl0 ^= bitMask;
-            *pl1 ^= bitMask;
-            *pl2 ^= bitMask;
-            break;
-    }
+    *pl0 = (*pl0 & (planeAnd[0] | ~bitMask)) ^ (planeXor[0] & bitMask);
+    *pl1 = (*pl1 & (planeAnd[1] | ~bitMask)) ^ (planeXor[1] & bitMask);
+    *pl2 = (*pl2 & (planeAnd[2] | ~bitMask)) ^ (planeXor[2] & bitMask);
 }
 
-
 /**
- * @brief      Draw bitmap for a 1 plane 6 bit colour display
+ * @brief      Get the drawing colour repeated for every pixel in a byte, in
+ *             a chunky mode.
+ *
+ * @return     Byte of pixels.
  */
-static inline void _VDUDrawBitmap6(void) {
-
-
-    switch(action) {
-
-        case 0:                                                                     // Standard draw
-            *pl0 =  ((*pl0) & (~bitMask)) | ((colour & 1) ? bitMask & 0xAA : 0) |
-                    ((colour & 8)  ? bitMask & 0x55:0);
-            *pl1 =  ((*pl1) & (~bitMask)) | ((colour & 2) ? bitMask & 0xAA : 0) |
-                    ((colour & 16) ? bitMask & 0x55 :0);
-            *pl2 =  ((*pl2) & (~bitMask)) | ((colour & 4) ? bitMask & 0xAA : 0) |
-                    ((colour & 32) ? bitMask & 0x55 :0);
-             break;
-        case 1:                                                                     // OR Draw
-            *pl0 |= (((colour & 1) ? bitMask & 0xAA:0) | ((colour & 8) ? bitMask & 0x55:0));
-            *pl1 |= (((colour & 2) ? bitMask & 0xAA:0) | ((colour & 16) ? bitMask & 0x55:0));
-            *pl2 |= (((colour & 4) ? bitMask & 0xAA:0) | ((colour & 32) ? bitMask & 0x55:0));
-            break;
-        case 2:                                                                     // AND Draw
-            *pl0 &= (((colour & 1) ? bitMask & 0xAA:0) | ((colour & 8) ? bitMask & 0x55:0));
-            *pl1 &= (((colour & 2) ? bitMask & 0xAA:0) | ((colour & 16) ? bitMask & 0x55:0));
-            *pl2 &= (((colour & 4) ? bitMask & 0xAA:0) | ((colour & 32) ? bitMask & 0x55:0));
-            break;
-        case 3:                                                                     // XOR Draw
-            *pl0 ^= (((colour & 1) ? bitMask & 0xAA:0) | ((colour & 8) ? bitMask & 0x55:0));
-            *pl1 ^= (((colour & 2) ? bitMask & 0xAA:0) | ((colour & 16) ? bitMask & 0x55:0));
-            *pl2 ^= (((colour & 4) ? bitMask & 0xAA:0) | ((colour & 32) ? bitMask & 0x55:0));
-            break;
-        case 4:                                                                     // Invert Draw
-            *pl0 ^= bitMask;
-            *pl1 ^= bitMask;
-            *pl2 ^= bitMask;
-            break;
-    }
+static inline uint8_t _VDUChunkyFill(void) {
+    return (_dmi->bitPlaneDepth == 4) ? (colour & 0x0F) * 0x11 : colour;
 }
 
 /**
@@ -403,7 +420,9 @@ static int _VDUAReadPixelDirect(void) {
     int colour = 0;
     if (!dataValid) return -1;                                                      // Off window
 
-    if (_dmi->bitPlaneDepth == 2) {                                                 // 64 colour mode.
+    if (_dmi->isChunky) {                                                           // Chunky mode, shift the pixel down.
+        colour = ((*pl0) & bitMask) / (bitMask & -bitMask);
+    } else if (_dmi->bitPlaneDepth == 2) {                                          // 64 colour mode.
         colour = _VDURPDPlane64(pl0) + (_VDURPDPlane64(pl1) << 1)                   // Extract colour bits from each plane.
                                                 + (_VDURPDPlane64(pl2) << 2); 
     } else {                                                                        // 1 bit per pixel planes (8, 2 colour modes)
@@ -64,6 +64,29 @@ static uint8_t _VDUMapToBitplaneByte64(uint8_t line,int plane) {
     return (line & fgBits) | ((~line) & bgBits);
 }
 
+/**
+ * @brief      Write a line of a character in a chunky mode, 8 pixels of the
+ *             foreground or background colour.
+ *
+ * @param      p       Where the pixels go, 4 or 8 bytes.
+ * @param[in]  pixels  Pixel data, left = MSB
+ * @param[in]  depth   Bits per pixel, 4 or 8
+ */
+static void _VDUMapToChunky(uint8_t *p,uint8_t pixels,int depth) {
+    if (depth == 8) {
+        for (int i = 0;i < 8;i++) {
+            *p++ = (pixels & 0x80) ? vc.fgCol : vc.bgCol;
+            pixels <<= 1;
+        }
+    } else {
+        uint8_t fg = vc.fgCol & 0x0F,bg = vc.bgCol & 0x0F;
+        for (int i = 0;i < 4;i++) {                                                 // 2 pixels a byte, left in the upper 4 bits.
+            *p++ = (((pixels & 0x80) ? fg : bg) << 4) | ((pixels & 0x40) ? fg : bg);
+            pixels <<= 2;
+        }
+    }
+}
+
 /**
  * @brief      Output a character onto the display, text mode, current fgr/bgr
  *
@@ -84,14 +107,19 @@ void VDURenderCharacter(int x,int y,int c) {
 
 
     DVIMODEINFO *dmi = DVIGetModeInformation();            
+    if (dmi->cellHeight != 0) {                                                     // Text mode, just store the cell.
+        VDUCellRender(x,y,c);
+        return;
+    }
     for (int plane = 0;plane < dmi->bitPlaneCount;plane++) {                        // Do all three planes.
         for (int yChar = 0;yChar < vc.textHeight;yChar++) {                         // Each line in a bit plane.
             uint8_t pixels = (vc.textHeight == 8) ?                                 // Get the character line data.
                                     VDUGetCharacterLineData(c,yChar,false):
                                     VDUGetCharacterLineData(c,yChar,true);   
-            uint8_t *p = dmi->bitPlane[plane]+                                      // Position in bitmap.
-                                (y*vc.textHeight+yChar)*dmi->bytesPerLine;      
-            if (dmi->bitPlaneDepth == 1) {                                          // Handle 8 bits per bitmap (8 colours)
+            uint8_t *p = DVIGetLineAddress(dmi,plane,y*vc.textHeight+yChar);        // Position in bitmap.
+            if (dmi->isChunky) {                                                    // Handle 4 or 8 bits per pixel, one plane.
+                _VDUMapToChunky(p+x*dmi->bitPlaneDepth,pixels,dmi->bitPlaneDepth);
+            } else if (dmi->bitPlaneDepth == 1) {                                   // Handle 8 bits per bitmap (8 colours)
                 *(p+x) = _VDUMapToBitplaneByte(pixels,plane);
             } else {                                                                // Handle 4 bits per bitmap (64 colours)
                 *(p+x*2) = _VDUMapToBitplaneByte64(_pixelMap[pixels >> 4],plane);
@@ -99,6 +127,7 @@ void VDURenderCharacter(int x,int y,int c) {
             }
         }
     }
+    DVIMarkDirty(y*vc.textHeight,(y+1)*vc.textHeight-1);
 }
 
 /**
@@ -115,19 +144,34 @@ void VDUScrollV(int yFrom,int yTo,int yTarget,int yClear,int xLeft, int xRight)
     DVIMODEINFO *dmi = DVIGetModeInformation();                                     // Get information.
     yFrom *= vc.textHeight;yTo *= vc.textHeight;yTarget *= vc.textHeight;           // Scale from characters to lines.
     int dir = (yFrom > yTarget) ? -1 : 1;                                           // How From and to are adjusted.
-    int bytesPerCharacter = (dmi->bitPlaneDepth == 1) ? 1 : 2;                      // Bytes per character. 
+    int bytesPerCharacter = dmi->bitPlaneDepth;                                     // Bytes per character, 8 pixels of this depth.
     int copySize = (vc.tw.xRight-vc.tw.xLeft+1) * bytesPerCharacter;                // Amount to copy.
+    int top = (dir > 0) ? yTo : yClear*vc.textHeight;                               // Lines of the area being scrolled.
+    int bottom = (dir > 0) ? yClear*vc.textHeight : yFrom;
+    if (top == 0 && bottom + vc.textHeight == dmi->height &&                        // Whole display, move the scroll offset
+                        xLeft == 0 && (xRight+1) * 8 == dmi->width) {               // and blank the row that wrapped round.
+        DVISetScrollOffset(dmi->yOffset + dir * vc.textHeight);
+        for (int x = vc.tw.xLeft;x <= vc.tw.xRight;x++) {
+            VDURenderCharacter(x,yClear,' ');
+        }
+        return;
+    }
+    if (dmi->cellHeight != 0) {                                                     // Text mode, copy rows of cells.
+        VDUCellScrollV(yFrom/vc.textHeight,yTo/vc.textHeight,yTarget/vc.textHeight,yClear,xLeft,xRight);
+        return;
+    }
     bool isComplete = false;
     while (!isComplete) {
         for (int i = 0;i < dmi->bitPlaneCount;i++) {                                // For each bitplane
             if (yFrom >= 0 && yTo >= 0 && yFrom < dmi->height && yTo < dmi->height) {
-                uint8_t *f = dmi->bitPlane[i] + dmi->bytesPerLine * yFrom;          // Start Line from
-                uint8_t *t = dmi->bitPlane[i] + dmi->bytesPerLine * yTo;            // Start Line to.
+                uint8_t *f = DVIGetLineAddress(dmi,i,yFrom);                        // Start Line from
+                uint8_t *t = DVIGetLineAddress(dmi,i,yTo);                          // Start Line to.
                 f = f + xLeft * bytesPerCharacter;                                  // Start of the copy block
                 t = t + xLeft * bytesPerCharacter;
                 memcpy(t,f,copySize);                                               // Copy it
             }   
         }        
+        DVIMarkDirty(yTo,yTo);
         if (yFrom == yTarget) isComplete = true;                                    // Done the last one ?
         yFrom += dir;yTo += dir;                                                    // Scroll the line down.
     }
@@ -148,7 +192,11 @@ void VDUScrollV(int yFrom,int yTo,int yTarget,int yClear,int xLeft, int xRight)
 void VDUScrollH(int xLeft,int xRight,int dir,int yTop, int yBottom)
 {
     DVIMODEINFO *dmi = DVIGetModeInformation();                                     // Get information.
-    int bytesPerCharacter = (dmi->bitPlaneDepth == 1) ? 1 : 2;                      // Bytes per character.
+    if (dmi->cellHeight != 0) {                                                     // Text mode, move the cells.
+        VDUCellScrollH(xLeft,xRight,dir,vc.tw.yTop,vc.tw.yBottom);
+        return;
+    }
+    int bytesPerCharacter = dmi->bitPlaneDepth;                                     // Bytes per character.
     int xFrom, xTo;
     if (dir < 0) {
         xTo = xLeft*bytesPerCharacter;
@@ -160,11 +208,12 @@ void VDUScrollH(int xLeft,int xRight,int dir,int yTop, int yBottom)
     int copySize = (vc.tw.xRight-vc.tw.xLeft)*bytesPerCharacter;                    // Amount to copy.
     for (int y=vc.tw.yTop*vc.textHeight; y<(vc.tw.yBottom+1)*vc.textHeight;y++) {
         for (int i = 0;i < dmi->bitPlaneCount;i++) {                                // For each bitplane
-            uint8_t *la = dmi->bitPlane[i] + dmi->bytesPerLine * y;                 // Start Line from
+            uint8_t *la = DVIGetLineAddress(dmi,i,y);                               // Start Line from
             memmove(la+xTo,la+xFrom,copySize);                                      // Copy it
         }        
     // Scroll the line left/right.
     }
+    DVIMarkDirty(vc.tw.yTop*vc.textHeight,(vc.tw.yBottom+1)*vc.textHeight-1);
     for (int y = vc.tw.yTop;y <= vc.tw.yBottom;y++) {                                // Blank the new column.
         VDURenderCharacter(dir<0?xRight:xLeft,y,' ');
     }
@@ -214,15 +263,17 @@ void VDUScrollRect(int ext, int direction)
  */
 void VDUCopyChar(int xFrom,int yFrom,int xTo,int yTo) {
     DVIMODEINFO *dmi = DVIGetModeInformation();            
-    uint32_t bytesPerCharacter = (dmi->bitPlaneDepth == 1) ? 1 : 2;                 // 1 or 2 bytes per character line.
+    if (dmi->cellHeight != 0) {                                                     // Text mode, copy the cell.
+        VDUCellCopy(xFrom,yFrom,xTo,yTo);
+        return;
+    }
+    uint32_t bytesPerCharacter = dmi->bitPlaneDepth;                                // 1,2,4 or 8 bytes per character line.
     for (int plane = 0;plane < dmi->bitPlaneCount;plane++) {                        // Each plane, calculate from and to.
-        uint8_t *f = dmi->bitPlane[plane]+xFrom*bytesPerCharacter+yFrom*vc.textHeight*dmi->bytesPerLine;
-        uint8_t *t = dmi->bitPlane[plane]+xTo  *bytesPerCharacter+yTo  *vc.textHeight*dmi->bytesPerLine;
-        for (int y = 0;y < vc.textHeight;y++) {                                     // Copy each line, 1 or 2 bytes
-            *t = *f;
-            if (bytesPerCharacter == 2) *(t+1) = *(f+1);
-            t += dmi->bytesPerLine;                                                 // Next line.
-            f += dmi->bytesPerLine;            
+        for (int y = 0;y < vc.textHeight;y++) {                                     // Copy each line
+            uint8_t *f = DVIGetLineAddress(dmi,plane,yFrom*vc.textHeight+y)+xFrom*bytesPerCharacter;
+            uint8_t *t = DVIGetLineAddress(dmi,plane,yTo*vc.textHeight+y)+xTo*bytesPerCharacter;
+            memcpy(t,f,bytesPerCharacter);
         }
     }
+    DVIMarkDirty(yTo*vc.textHeight,(yTo+1)*vc.textHeight-1);
 }
\ No newline at end of file
@@ -22,6 +22,7 @@
  */
 void VDUPlotDispatch(int cmd,int *xCoord,int *yCoord) {
 	int r,r2;
+	PROFILE_BEGIN();																// Time the command, if profiling.
 	// printf("%d %d,%d %d,%d %d,%d\n",cmd,xCoord[0],yCoord[0],xCoord[1],yCoord[1],xCoord[2],yCoord[2]);
 	switch(cmd) {
 		case 0:  																	// 0-31 Line drawers. Variants are set previously.
@@ -70,4 +71,5 @@ void VDUPlotDispatch(int cmd,int *xCoord,int *yCoord) {
 				VDUAFillEllipse(xCoord[2]-r,yCoord[1]-r2,xCoord[2]+r,yCoord[1]+r2);
 			}
 	}
+	PROFILE_END(PROFILE_PLOT,cmd >> 3);
 }
@@ -35,6 +35,8 @@ void VDUSetTextColour(int colour) {
 void VDUSetTextSize(uint8_t xSize,uint8_t ySize) {
     vc.textWidth = 8;
     vc.textHeight = (ySize == 2) ? 16:8;
+    uint32_t cellHeight = DVIGetModeInformation()->cellHeight;
+    if (cellHeight != 0) vc.textHeight = cellHeight;                                // Text modes have a fixed cell size.
 }
 
 /**
@@ -27,6 +27,9 @@ uint8_t VDURead(uint16_t x,uint16_t y) {
     DVIMODEINFO *dmi = DVIGetModeInformation();
     bool bDouble = (vc.textHeight == 16);
     uint8_t charDef[16];                                                            // Character bitmap.
+    if (dmi->cellHeight != 0) {                                                     // Text mode, it is in the cell.
+        return VDUCellRead(x + vc.tw.xLeft,y + vc.tw.yTop);
+    }
     x = (x + vc.tw.xLeft) * vc.textWidth;                                           // These are now pixel positions.
     y = (y + vc.tw.yTop) * vc.textHeight; 
     c1 = VDUAReadPixel(x,dmi->height-1-(y+vc.textHeight-1),true);                   // The background pixel is *probably* the first on the bottom row.
@@ -57,6 +57,29 @@ void VDUSetGraphicsColour(uint8_t mode,uint8_t colour) {
 }
 
 
+/**
+ * @brief      Redefine a logical colour (VDU 19). This only works in the chunky
+ *             modes, which have a palette. The logical colour is reduced modulo
+ *             the number of colours. Physical colour 16 sets it to r,g,b (0-255
+ *             each), otherwise it is set to the mode's default for that colour.
+ *
+ * @param[in]  logical   Logical colour
+ * @param[in]  physical  Physical colour, or 16
+ * @param[in]  r         Red
+ * @param[in]  g         Green
+ * @param[in]  b         Blue
+ */
+void VDUDefineLogicalColour(int logical,int physical,int r,int g,int b) {
+    DVIMODEINFO *dmi = DVIGetModeInformation();
+    if (!dmi->isChunky) return;                                                     // The bitplane modes' colours are fixed.
+    logical &= (1 << dmi->bitPlaneDepth)-1;
+    if (physical == 16) {
+        DVISetPalette(logical,(r << 16) | (g << 8) | b);
+    } else {
+        DVISetPalette(logical,DVIGetDefaultPalette(physical));
+    }
+}
+
 /**
  * @brief      Set the graphics origin
  *
@@ -97,7 +97,10 @@ void VDUWrite(uint8_t c) {
         if (_vduPendingCommand != 1 && _vduPendingCommand != 6) return;             // Exit for everything except 1 and 6
     }
 
-    switch(_vduPendingCommand) {                                                    // So, what do we do as we now have a complete command.
+    PROFILE_BEGIN();                                                                // Time the command, if profiling.
+    uint8_t command = _vduPendingCommand;                                           // Commands may call VDUWrite() again.
+
+    switch(command) {                                                               // So, what do we do as we now have a complete command.
 
         case 0:                                                                     // 0 does nothing.
             break;
@@ -165,12 +168,14 @@ void VDUWrite(uint8_t c) {
             VDUSetGraphicsColour(_vduBuffer[0],_vduBuffer[1]);                       
             break;
 
-        case 19:                                                                    // 19 colour redefine (not allowed)            
+        case 19:                                                                    // 19 l,p,r,g,b colour redefine (chunky modes only)
+            VDUDefineLogicalColour(_vduBuffer[0],_vduBuffer[1],_vduBuffer[2],_vduBuffer[3],_vduBuffer[4]);
             break;
 
         case 20:                                                                    // 20 set default text, graphics colours (and mapping)
             VDUSetDefaultTextColour();
             VDUSetDefaultGraphicColour();
+            DVIResetPalette();
             break;
 
         case 21:
@@ -269,6 +274,7 @@ void VDUWrite(uint8_t c) {
     if (!vc.writeTextToGraphics) {
         VDUShowCursor();
     }
+    PROFILE_END(PROFILE_VDU,(command < 32 || command == 127) ? command : 32);
 }
 
 /**
@@ -289,6 +295,7 @@ void VDUWriteWord(uint32_t word) {
 static void _VDUSwitchMode(uint32_t newMode) {
     if (newMode < 0 || newMode >= DVI_MODE_COUNT) return;                           // Validate the mode.
     DVISetMode(newMode);                                                            // Set the physical driver mode.
+    if (DVIGetModeInformation()->cellHeight != 0) VDUSetTextSize(1,1);              // Text modes use their own font size.
     vc.vduEnabled = true;
     vc.cursorIsVisible = false;vc.cursorIsEnabled = true;
     VDUWrite(20);                                                                   // Reset colours
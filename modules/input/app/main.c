@@ -35,6 +35,7 @@ int MAINPROGRAM(int argc,char *argv[]) {
     for (int i = 0;i < info.bitPlaneCount;i++) {                                    // Blue background.
         memset(info.bitPlane[i],(i == 2) ? 0xFF:0x00,info.bitPlaneSize);
     }
+    DVIMarkAllDirty();
     INPInitialise();                                                                // Initialise input module.
     while (COMAppRunning()) {                                                       // This is for the run time library.
         int16_t x,y,s,b;
@@ -102,4 +103,5 @@ static void plotPixel(int x,int y,int colour) {
         info.bitPlane[plane][pos] &= ~mask;        
         if (colour & (1 << plane)) info.bitPlane[plane][pos] |= mask;
     }
+    DVIMarkDirty(y,y);
 }
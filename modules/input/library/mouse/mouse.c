@@ -11,6 +11,7 @@
 
 #include "input_module.h"
 #include "input_module_local.h"
+#include "dvi_module.h"
 
 #define INP_MOUSE_XMAX      (1280)                                                  // Max extent of mouse is 1280x960
 #define INP_MOUSE_YMAX      (960)
@@ -19,6 +20,15 @@ static int32_t xMouse = INP_MOUSE_XMAX / 2;
 static int32_t yMouse = INP_MOUSE_YMAX / 2;
 static int32_t buttons = 0;
 
+/**
+ * @brief      Move the display's pointer to the mouse position, scaled to the
+ *             current mode. The scanout draws it, so this is all it costs.
+ */
+static void _INPUpdatePointer(void) {
+    DVIMODEINFO *dm = DVIGetModeInformation();
+    DVIMovePointer(xMouse * (int)dm->width / INP_MOUSE_XMAX,yMouse * (int)dm->height / INP_MOUSE_YMAX);
+}
+
 /**
  * @brief      Initialise the mouse subsystem
  */
@@ -26,6 +36,7 @@ void INPMouseInitialise(void) {
     xMouse = INP_MOUSE_XMAX / 2;
     yMouse = INP_MOUSE_YMAX / 2;
     buttons = 0;
+    _INPUpdatePointer();
 }
 
 /**
@@ -47,6 +58,7 @@ void INPProcessMouseReport(USBREPORT *r) {
 
     xMouse = x;
     yMouse = y;
+    _INPUpdatePointer();                                                            // Pointer follows the mouse.
 
     buttons = 0;                                                                    // Convert the button records into a bit record.
     if (r->data[6]) buttons |= 0x01;
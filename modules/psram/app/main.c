@@ -49,13 +49,13 @@ int MAINPROGRAM(int argc,char *argv[]) {
     LOG("Testing %d of %d",count,PSRGetMemorySize());
     lfsrReset();
     for (int i = 0;i < count;i++) {
-        psRAM[i] = lfsr();
+        PSRWRITE8(psRAM+i,lfsr());
     }
 
     lfsrReset();
     for (int i = 0;i < count;i++) {
         uint8_t n = lfsr();
-        if (n != psRAM[i]) LOG("%d %d %d",i,psRAM[i],n);
+        if (n != PSRREAD8(psRAM+i)) LOG("%d %d %d",i,psRAM[i],n);
     }
 
     while (COMAppRunning()) {
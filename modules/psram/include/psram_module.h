@@ -20,4 +20,24 @@
 
 void PSRInitialise(void);
 uint8_t *PSRGetMemoryAddress(void);
-uint32_t PSRGetMemorySize(void);
\ No newline at end of file
+uint32_t PSRGetMemorySize(void);
+
+//
+//      Accessors for data in PSRAM. On the hardware these are plain memory accesses. In the runtime, built with
+//      PSRAM_CACHE_MODEL, each access goes through a model of the XIP cache, which reports hits, misses and
+//      estimated stall cycles for each place they are used.
+//
+#if defined(RUNTIME) && defined(PSRAM_CACHE_MODEL)
+void PSRCacheAccess(const void *address,uint32_t size,bool isWrite,const char *file,int line);
+void PSRCacheReport(void);
+#define PSRACCESS(p,n,w)    PSRCacheAccess((p),(n),(w),__FILE__,__LINE__)
+#else
+#define PSRACCESS(p,n,w)    ((void)0)
+#endif
+
+#define PSRREAD8(p)         (PSRACCESS(p,1,false),*(uint8_t *)(p))                  // Read from PSRAM
+#define PSRREAD16(p)        (PSRACCESS(p,2,false),*(uint16_t *)(p))
+#define PSRREAD32(p)        (PSRACCESS(p,4,false),*(uint32_t *)(p))
+#define PSRWRITE8(p,v)      (PSRACCESS(p,1,true),*(uint8_t *)(p) = (v))             // Write to PSRAM
+#define PSRWRITE16(p,v)     (PSRACCESS(p,2,true),*(uint16_t *)(p) = (v))
+#define PSRWRITE32(p,v)     (PSRACCESS(p,4,true),*(uint32_t *)(p) = (v))
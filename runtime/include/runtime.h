@@ -19,27 +19,89 @@
 #include "dvi_module.h"
 #include "psram_module.h"
 
+#ifndef HEADLESS
 #include <SDL.h>
+#endif
 #include <unistd.h> 
 #include <sys/stat.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <time.h>
+#include <stddef.h>
 
-#define AS_SCALEX 	(3)
-#define AS_SCALEY   (2)
+#define DEFAULT_SCALEX  (3)                                                         // Default display scaling.
+#define DEFAULT_SCALEY  (2)
 
 #define __in_flash()
 
+//
+//      Command line options.
+//
+#define MAX_DUMP_FRAMES     (32)
+
+typedef struct _RuntimeOptions {
+    uint32_t maxFrames;                                                             // Stop after this many frames, 0 = no limit.
+    uint32_t maxTime;                                                               // Stop after this many ms, 0 = no limit.
+    uint32_t dumpEvery;                                                             // Dump every n frames, 0 = don't.
+    uint32_t dumpCount;                                                             // Number of specific frames to dump.
+    uint32_t dumpFrames[MAX_DUMP_FRAMES];                                           // Specific frames to dump.
+    char *dumpFileName;                                                             // printf format for dump file, given the frame number.
+    bool benchmark;                                                                 // Run the conversion benchmark rather than the app.
+    bool threaded;                                                                  // Display runs on its own thread.
+    int scaleX,scaleY;                                                              // Display scaling in the window.
+    bool letterbox;                                                                 // Resizable window, largest whole scale that fits.
+    double frameRate;                                                               // Frames per second.
+    char *frameLogFileName;                                                         // Per frame timing log, NULL = none.
+    uint32_t virtualClockStep;                                                      // Virtual clock step in us, 0 = real time.
+    char *recordFileName;                                                           // Record the display to this, NULL = don't.
+    char *playFileName;                                                             // Play this recording instead of the app, NULL = don't.
+    char *recordInputFileName;                                                      // Record input to this, NULL = don't.
+    char *replayInputFileName;                                                      // Replay input from this, NULL = don't.
+} RUNTIMEOPTIONS;
+
+RUNTIMEOPTIONS *SYSGetOptions(void);
+
 void SYSOpen(bool muteSound);
 int SYSPollUpdate(void);
 void SYSClose(void);
-void SYSRectangle(SDL_Rect *rc,int colour);
-SDL_Surface *SYSGetSurface(void);
 
-void RNDRender(SDL_Surface *surface);
+#ifndef HEADLESS
+bool RNDRender(SDL_Texture *texture,SDL_Rect *rc);
+#endif
+bool RNDWritePPM(char *fileName);
+
+uint64_t SYSClockMicroseconds(void);
+void SYSSetVirtualClock(uint32_t stepMicroseconds);
+bool SYSIsVirtualClock(void);
+void SYSAdvanceClock(void);
+uint64_t SYSAppClockMicroseconds(void);
+void SYSTimingStart(char *logFileName);
+void SYSTimingBeginFrame(void);
+void SYSTimingEndFrame(void);
+void SYSTimingReport(double frameRate);
+void SYSProfileReport(void);
+
+void RECStartRecording(char *fileName);
+void RECRecordFrame(void);
+void RECEndRecording(void);
+void RECPlay(char *fileName);
+
+void RNDInitialiseConversion(void);
+void RNDPlanarToChunky(DVIMODEINFO *dm,int y,uint8_t *target);
+void RNDBenchmarkConversion(void);
+void RNDBenchmarkTMDS(void);
+void RNDModelScanout(void);
 
 void KBDProcessEvent(int scanCode,int modifiers,bool isDown);
 void USBDispatchPacket(USBREPORT *r);
+void USBQueuePacket(USBREPORT *r);
+void USBProcessQueue(void);
+void USBStartInputRecording(char *fileName);
+void USBRecordInput(USBREPORT *r);
+void USBStartInputReplay(char *fileName);
+bool USBIsReplayingInput(void);
+void USBReplayInput(void);
+void USBEndInputRecording(void);
 void SYSUpdateMouse(void);
 void CTLFindControllers(void);
 
@@ -16,6 +16,9 @@
 static COMUPDATEFUNCTION updateFunctions[MAX_UPDATE_FUNCS];                         // Update functions
 static uint32_t updateFunctionCount = 0;
 
+static uint32_t virtualStep = 0;                                                    // Virtual clock step in us, 0 = real time.
+static uint64_t virtualTime = 0;                                                    // Virtual time in us.
+
 /**
  * @brief      Dummy initialise
  */
@@ -28,7 +31,56 @@ void COMInitialise(void) {
  * @return     time in 1khz ticks
  */
 uint32_t COMClock(void) {
+    if (virtualStep != 0) return (uint32_t)(virtualTime / 1000);                    // Virtual time.
+    #ifdef HEADLESS
+    static uint64_t startTime = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);                                             // No SDL, so use the monotonic clock.
+    uint64_t now = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    if (startTime == 0) startTime = now;                                            // Relative to the first call, like SDL_GetTicks()
+    return (uint32_t)(now - startTime);
+    #else
     return SDL_GetTicks();
+    #endif
+}
+
+/**
+ * @brief      Use a virtual clock. Time only moves when the app yields, by a
+ *             fixed step each time, so runs are repeatable and go as fast as
+ *             the host allows.
+ *
+ * @param[in]  stepMicroseconds  Time added each yield.
+ */
+void SYSSetVirtualClock(uint32_t stepMicroseconds) {
+    virtualStep = stepMicroseconds;
+    virtualTime = 0;
+}
+
+/**
+ * @brief      Is the clock virtual ?
+ *
+ * @return     true if using a virtual clock.
+ */
+bool SYSIsVirtualClock(void) {
+    return virtualStep != 0;
+}
+
+/**
+ * @brief      Move the virtual clock on one step, called on every yield.
+ */
+void SYSAdvanceClock(void) {
+    virtualTime += virtualStep;
+}
+
+/**
+ * @brief      The app's clock in microseconds ; the virtual clock if there is
+ *             one, otherwise the high resolution clock. Frames are paced off
+ *             this.
+ *
+ * @return     Microseconds since the start.
+ */
+uint64_t SYSAppClockMicroseconds(void) {
+    return (virtualStep != 0) ? virtualTime : SYSClockMicroseconds();
 }
 
 /**
@@ -59,9 +111,13 @@ void COMAddUpdateFunction(COMUPDATEFUNCTION updateFunc) {
  */
 void COMUpdate(void) {
     for (int i = 0;i < updateFunctionCount;i++) {
+        PROFILE_BEGIN();
         (*updateFunctions[i])();
+        PROFILE_END(PROFILE_UPDATE,i);
     }
+    PROFILE_BEGIN();
     SYSYield();
+    PROFILE_END(PROFILE_UPDATE,PROFILE_YIELD);
 }
 
 /**
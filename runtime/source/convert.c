@@ -0,0 +1,334 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      convert.c
+//      Purpose :   Planar to chunky conversion kernels.
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+
+//
+//      These convert one line of 3 bitplanes into one byte per pixel, which is the colour index. This is
+//      0-7 (BGR) for the 1 bit per plane modes and 0-63 (BBGGRR) for the 2 bit per plane mode. Each is
+//      given the three plane pointers, the number of bytes per plane and where the pixels go.
+//
+typedef void (*RNDCONVERTER)(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target);
+
+static uint64_t expand_1bpp[256];                                                   // 8 pixels, 1 bit each -> 8 bytes (leftmost pixel in byte 0)
+static uint32_t expand_2bpp[256];                                                   // 4 pixels, 2 bits each -> 4 bytes (leftmost pixel in byte 0)
+
+static RNDCONVERTER convert1bpp,convert2bpp;                                        // Converters selected for this machine.
+
+/**
+ * @brief      The original converter, a pixel at a time with shifts. This is
+ *             kept as a reference to check and benchmark the others against.
+ */
+static void _RNDReference1bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    while (bytes-- > 0) {
+        uint8_t r = *p0++,g = *p1++,b = *p2++;
+        for (int bt = 0;bt < 8;bt++) {
+            *target++ = ((r & 0x80) >> 7)+((g & 0x80) >> 6)+((b & 0x80) >> 5);
+            r <<= 1;g <<= 1;b <<= 1;
+        }
+    }
+}
+
+static void _RNDReference2bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    while (bytes-- > 0) {
+        uint8_t r = *p0++,g = *p1++,b = *p2++;
+        for (int bt = 0;bt < 4;bt++) {
+            *target++ = ((r & 0xC0) >> 6)+((g & 0xC0) >> 4)+((b & 0xC0) >> 2);
+            r <<= 2;g <<= 2;b <<= 2;
+        }
+    }
+}
+
+/**
+ * @brief      Portable converters, using tables to expand each plane byte to
+ *             one byte per pixel and combining the planes 8 (or 4) pixels at a
+ *             time. This assumes a little endian host.
+ */
+static void _RNDTable1bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    while (bytes-- > 0) {
+        uint64_t c = expand_1bpp[*p0++] | (expand_1bpp[*p1++] << 1) | (expand_1bpp[*p2++] << 2);
+        memcpy(target,&c,8);target += 8;
+    }
+}
+
+static void _RNDTable2bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    while (bytes-- > 0) {
+        uint32_t c = expand_2bpp[*p0++] | (expand_2bpp[*p1++] << 2) | (expand_2bpp[*p2++] << 4);
+        memcpy(target,&c,4);target += 4;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+//
+//      SSE2 and AVX2 versions. Each plane's bytes are broadcast so every pixel has its own copy of the
+//      byte in one lane, then masked with that pixel's bit and compared, giving 0xFF where the bit is set.
+//      That is masked with the plane's weight and the planes ORed together.
+//
+#define SSE2    __attribute__((target("sse2")))
+#define AVX2    __attribute__((target("avx2")))
+
+/**
+ * @brief      SSE2, 1 bit per pixel. Spread 2 bytes so each pixel has its own
+ *             copy of its byte, then test each pixel's bit.
+ */
+SSE2 static inline __m128i _RNDSSE2Spread1(uint8_t *p,__m128i bits,int weight) {
+    __m128i v = _mm_cvtsi32_si128(p[0] | (p[1] << 8));                              // 2 bytes
+    v = _mm_unpacklo_epi8(v,v);                                                     // b0 b0 b1 b1
+    v = _mm_unpacklo_epi16(v,v);                                                    // b0 x 4 b1 x 4
+    v = _mm_unpacklo_epi32(v,v);                                                    // b0 x 8 b1 x 8
+    v = _mm_cmpeq_epi8(_mm_and_si128(v,bits),bits);                                 // 0xFF where pixel set
+    return _mm_and_si128(v,_mm_set1_epi8(weight));                                  // Plane weight where pixel set.
+}
+
+/**
+ * @brief      SSE2, 16 pixels (2 bytes per plane) each step.
+ */
+SSE2 static void _RNDSSE21bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    const __m128i bits = _mm_setr_epi8(0x80,0x40,0x20,0x10,8,4,2,1,0x80,0x40,0x20,0x10,8,4,2,1);
+    int x = 0;
+    for (;x+2 <= bytes;x += 2) {
+        __m128i c = _mm_or_si128(_mm_or_si128(_RNDSSE2Spread1(p0+x,bits,1),_RNDSSE2Spread1(p1+x,bits,2)),
+                                 _RNDSSE2Spread1(p2+x,bits,4));
+        _mm_storeu_si128((__m128i *)(target+x*8),c);
+    }
+    _RNDTable1bpp(p0+x,p1+x,p2+x,bytes-x,target+x*8);                               // Anything left over.
+}
+
+/**
+ * @brief      SSE2, 2 bits per pixel. Spread 4 bytes so each pixel has its own
+ *             copy, then test both of each pixel's bits.
+ */
+SSE2 static inline __m128i _RNDSSE2Spread2(uint8_t *p,__m128i hiBits,__m128i loBits,int weight) {
+    uint32_t w;memcpy(&w,p,4);
+    __m128i v = _mm_cvtsi32_si128(w);                                               // 4 bytes
+    v = _mm_unpacklo_epi8(v,v);                                                     // b0 b0 b1 b1 b2 b2 b3 b3
+    v = _mm_unpacklo_epi16(v,v);                                                    // b0 x 4 .. b3 x 4
+    __m128i hi = _mm_cmpeq_epi8(_mm_and_si128(v,hiBits),hiBits);
+    __m128i lo = _mm_cmpeq_epi8(_mm_and_si128(v,loBits),loBits);
+    return _mm_or_si128(_mm_and_si128(hi,_mm_set1_epi8(weight*2)),_mm_and_si128(lo,_mm_set1_epi8(weight)));
+}
+
+/**
+ * @brief      SSE2, 16 pixels (4 bytes per plane) each step.
+ */
+SSE2 static void _RNDSSE22bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    const __m128i hiBits = _mm_set1_epi32(0x02082080);
+    const __m128i loBits = _mm_srli_epi16(hiBits,1);
+    int x = 0;
+    for (;x+4 <= bytes;x += 4) {
+        __m128i c = _mm_or_si128(_mm_or_si128(_RNDSSE2Spread2(p0+x,hiBits,loBits,1),_RNDSSE2Spread2(p1+x,hiBits,loBits,4)),
+                                 _RNDSSE2Spread2(p2+x,hiBits,loBits,16));
+        _mm_storeu_si128((__m128i *)(target+x*4),c);
+    }
+    _RNDTable2bpp(p0+x,p1+x,p2+x,bytes-x,target+x*4);
+}
+
+/**
+ * @brief      AVX2, 1 bit per pixel, 4 bytes to 32 pixels. The shuffle does
+ *             the spreading in one go.
+ */
+AVX2 static inline __m256i _RNDAVX2Spread1(uint8_t *p,__m256i bits,__m256i spread,int weight) {
+    uint32_t w;memcpy(&w,p,4);
+    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32(w),spread);                   // Each byte x 8
+    v = _mm256_cmpeq_epi8(_mm256_and_si256(v,bits),bits);
+    return _mm256_and_si256(v,_mm256_set1_epi8(weight));
+}
+
+/**
+ * @brief      AVX2, 32 pixels (4 bytes per plane) each step.
+ */
+AVX2 static void _RNDAVX21bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    const __m256i bits = _mm256_set1_epi64x(0x0102040810204080);
+    const __m256i spread = _mm256_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,
+                                            2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+    int x = 0;
+    for (;x+4 <= bytes;x += 4) {
+        __m256i c = _mm256_or_si256(_mm256_or_si256(_RNDAVX2Spread1(p0+x,bits,spread,1),_RNDAVX2Spread1(p1+x,bits,spread,2)),
+                                    _RNDAVX2Spread1(p2+x,bits,spread,4));
+        _mm256_storeu_si256((__m256i *)(target+x*8),c);
+    }
+    _RNDTable1bpp(p0+x,p1+x,p2+x,bytes-x,target+x*8);
+}
+
+/**
+ * @brief      AVX2, 2 bits per pixel, 8 bytes to 32 pixels.
+ */
+AVX2 static inline __m256i _RNDAVX2Spread2(uint8_t *p,__m256i hiBits,__m256i loBits,__m256i spread,int weight) {
+    int64_t w;memcpy(&w,p,8);
+    __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi64x(w),spread);                  // Each byte x 4
+    __m256i hi = _mm256_cmpeq_epi8(_mm256_and_si256(v,hiBits),hiBits);
+    __m256i lo = _mm256_cmpeq_epi8(_mm256_and_si256(v,loBits),loBits);
+    return _mm256_or_si256(_mm256_and_si256(hi,_mm256_set1_epi8(weight*2)),_mm256_and_si256(lo,_mm256_set1_epi8(weight)));
+}
+
+/**
+ * @brief      AVX2, 32 pixels (8 bytes per plane) each step.
+ */
+AVX2 static void _RNDAVX22bpp(uint8_t *p0,uint8_t *p1,uint8_t *p2,int bytes,uint8_t *target) {
+    const __m256i hiBits = _mm256_set1_epi32(0x02082080);
+    const __m256i loBits = _mm256_srli_epi16(hiBits,1);
+    const __m256i spread = _mm256_setr_epi8(0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,
+                                            4,4,4,4,5,5,5,5,6,6,6,6,7,7,7,7);
+    int x = 0;
+    for (;x+8 <= bytes;x += 8) {
+        __m256i c = _mm256_or_si256(_mm256_or_si256(_RNDAVX2Spread2(p0+x,hiBits,loBits,spread,1),
+                                                     _RNDAVX2Spread2(p1+x,hiBits,loBits,spread,4)),
+                                    _RNDAVX2Spread2(p2+x,hiBits,loBits,spread,16));
+        _mm256_storeu_si256((__m256i *)(target+x*4),c);
+    }
+    _RNDTable2bpp(p0+x,p1+x,p2+x,bytes-x,target+x*4);
+}
+
+static bool _RNDHasSSE2(void) { return __builtin_cpu_supports("sse2"); }
+static bool _RNDHasAVX2(void) { return __builtin_cpu_supports("avx2"); }
+#endif
+
+static bool _RNDAlways(void) { return true; }
+
+//
+//      All the converters, in order of preference, last first. SSE2 is slower than the table converter in
+//      the 1 bit modes and only a little faster in the 2 bit one, so it is ranked below it and is only
+//      there to be benchmarked.
+//
+static const struct _ConverterInfo {
+    char *name;
+    RNDCONVERTER convert1bpp,convert2bpp;
+    bool (*isAvailable)(void);
+} converters[] = {
+    { "Reference", _RNDReference1bpp,_RNDReference2bpp,_RNDAlways },
+    #if defined(__x86_64__) || defined(__i386__)
+    { "SSE2",      _RNDSSE21bpp,_RNDSSE22bpp,_RNDHasSSE2 },
+    #endif
+    { "Table",     _RNDTable1bpp,_RNDTable2bpp,_RNDAlways },
+    #if defined(__x86_64__) || defined(__i386__)
+    { "AVX2",      _RNDAVX21bpp,_RNDAVX22bpp,_RNDHasAVX2 },
+    #endif
+};
+
+#define CONVERTER_COUNT ((int)(sizeof(converters)/sizeof(converters[0])))
+
+/**
+ * @brief      Build the tables and pick the best converter this machine can
+ *             run.
+ */
+void RNDInitialiseConversion(void) {
+    for (int i = 0;i < 256;i++) {                                                   // Build the bit expansion tables.
+        expand_1bpp[i] = 0;expand_2bpp[i] = 0;
+        for (int b = 0;b < 8;b++) {
+            if (i & (0x80 >> b)) expand_1bpp[i] |= ((uint64_t)1) << (b*8);
+        }
+        for (int b = 0;b < 4;b++) {
+            expand_2bpp[i] |= ((i >> (6-b*2)) & 3) << (b*8);
+        }
+    }
+    for (int i = 0;i < CONVERTER_COUNT;i++) {                                       // Use the last one available.
+        if (converters[i].isAvailable()) {
+            convert1bpp = converters[i].convert1bpp;
+            convert2bpp = converters[i].convert2bpp;
+        }
+    }
+}
+
+/**
+ * @brief      Convert one line of a text mode to colour indices, drawing the
+ *             cells through the font as the scanout does.
+ *
+ * @param      dm      Mode information
+ * @param[in]  y       Line number (0 is the top)
+ * @param      target  Where the pixels go, dm->width of them.
+ */
+static void _RNDCellsToChunky(DVIMODEINFO *dm,int y,uint8_t *target) {
+    uint32_t line = (y + dm->yOffset) % dm->height;                                 // Plane line, after the scroll offset.
+    uint16_t *cell = (uint16_t *)(dm->bitPlane[0] + DVIGetLineOffset(dm,line));
+    const uint8_t *font = DVIGetTextFont() + line % dm->cellHeight;                 // Font line for this line of the row.
+    for (int x = 0;x < dm->width / 8;x++) {
+        uint8_t pixels = font[DVI_CELL_CHAR(cell[x]) * dm->cellHeight];
+        uint8_t fg = DVI_CELL_FG(cell[x]),bg = DVI_CELL_BG(cell[x]);
+        for (int b = 0;b < 8;b++) {
+            *target++ = (pixels & 0x80) ? fg : bg;
+            pixels <<= 1;
+        }
+    }
+}
+
+/**
+ * @brief      Convert one line of the current display to colour indices, one
+ *             byte per pixel.
+ *
+ * @param      dm      Mode information
+ * @param[in]  y       Line number (0 is the top)
+ * @param      target  Where the pixels go, dm->width of them.
+ */
+void RNDPlanarToChunky(DVIMODEINFO *dm,int y,uint8_t *target) {
+    if (dm->cellHeight != 0) {                                                      // Text mode, colours 0-7 as the 8 colour modes.
+        _RNDCellsToChunky(dm,y,target);
+        return;
+    }
+    uint32_t offset = DVIGetLineAddress(dm,0,y) - dm->bitPlane[0];                  // Line in the planes, after the scroll offset.
+    if (dm->isChunky) {                                                             // Already chunky, 8 or 4 bits per pixel.
+        uint8_t *source = dm->bitPlane[0]+offset;
+        if (dm->bitPlaneDepth == 8) {
+            memcpy(target,source,dm->width);
+        } else {
+            for (int x = 0;x < dm->width;x += 2) {
+                *target++ = *source >> 4;*target++ = *source++ & 0x0F;
+            }
+        }
+        return;
+    }
+    (dm->bitPlaneDepth == 1 ? convert1bpp : convert2bpp)(dm->bitPlane[0]+offset,dm->bitPlane[1]+offset,
+                                                         dm->bitPlane[2]+offset,dm->bytesPerLine,target);
+}
+
+/**
+ * @brief      Benchmark every available converter against the reference in
+ *             every mode, checking they produce the same result.
+ */
+void RNDBenchmarkConversion(void) {
+    static uint8_t reference[FRAME_WIDTH],result[FRAME_WIDTH];
+    const int repeats = 200;
+    RNDInitialiseConversion();
+    for (int i = 0;i < VIDEO_BYTES;i++) framebuf[i] = rand();                       // Random display.
+    printf("%-6s %-10s %10s %8s\n","Mode","Converter","Mpixels/s","Speedup");
+    for (int mode = 0;mode < DVI_MODE_COUNT;mode++) {
+        DVISetMode(mode);
+        DVIMODEINFO *dm = DVIGetModeInformation();
+        if (dm->isChunky || dm->cellHeight != 0) continue;                          // Nothing to convert.
+        double baseTime = 0;
+        for (int c = 0;c < CONVERTER_COUNT;c++) {
+            if (!converters[c].isAvailable()) continue;
+            RNDCONVERTER convert = (dm->bitPlaneDepth == 1) ? converters[c].convert1bpp : converters[c].convert2bpp;
+            RNDCONVERTER check = (dm->bitPlaneDepth == 1) ? _RNDReference1bpp : _RNDReference2bpp;
+            for (int y = 0;y < dm->height;y++) {                                    // Check it gets the right answer.
+                uint32_t offset = y * dm->bytesPerLine;
+                check(dm->bitPlane[0]+offset,dm->bitPlane[1]+offset,dm->bitPlane[2]+offset,dm->bytesPerLine,reference);
+                convert(dm->bitPlane[0]+offset,dm->bitPlane[1]+offset,dm->bitPlane[2]+offset,dm->bytesPerLine,result);
+                if (memcmp(reference,result,dm->width) != 0) {
+                    printf("%s converter is wrong in mode %d line %d\n",converters[c].name,mode,y);
+                    break;
+                }
+            }
+            clock_t start = clock();                                                // Time full frame conversions.
+            for (int r = 0;r < repeats;r++) {
+                for (int y = 0;y < dm->height;y++) {
+                    uint32_t offset = y * dm->bytesPerLine;
+                    convert(dm->bitPlane[0]+offset,dm->bitPlane[1]+offset,dm->bitPlane[2]+offset,dm->bytesPerLine,result);
+                }
+            }
+            double elapsed = (double)(clock()-start) / CLOCKS_PER_SEC + 1e-9;
+            if (c == 0) baseTime = elapsed;
+            printf("%-6d %-10s %10.1f %7.1fx\n",mode,converters[c].name,
+                                    (double)repeats*dm->width*dm->height/elapsed/1e6,baseTime/elapsed);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      headless.c
+//      Purpose :   System code for the headless (no display) runtime
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+
+#ifdef HEADLESS
+
+static int startTime = 0,endTime = 0,frameCount = 0;
+
+/**
+ * @brief      Start everything off. There is no window, the app just runs
+ *             against framebuf.
+ *
+ * @param[in]  muteSound  Mute sound (there is no sound anyway)
+ */
+void SYSOpen(bool muteSound) {
+    startTime = COMClock();
+}
+
+/**
+ * @brief      Frame update. There are no events and nothing to draw on.
+ *
+ * @return     non zero, as there's nothing to stop it other than the frame
+ *             and time limits.
+ */
+int SYSPollUpdate(void) {
+    frameCount++;
+    __atomic_add_fetch(&dvi_frameCount,1,__ATOMIC_RELEASE);                         // Vertical sync, as the display would.
+    return -1;
+}
+
+/**
+ * @brief      Close down everything
+ */
+void SYSClose(void) {
+    endTime = COMClock();
+    printf("Frame Rate %.2f\n",frameCount/((endTime-startTime+1)/1000.0));
+}
+
+#endif
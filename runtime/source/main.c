@@ -13,9 +13,29 @@
 
 bool isAppRunning = true;
 
-#define FRAME_RATE  (70)                                                            // Seems to be closest to the ctual finished thing.
+#define FRAME_RATE  (60)                                                            // The DVI timing is 640x480 60Hz
 
-static int nextUpdateTime = 0;
+static uint64_t nextFrameTime = 0;                                                  // When the next frame is due, in us.
+static uint32_t frameNumber = 0;                                                    // Frames completed
+static uint32_t startTime = 0;                                                      // Time app started.
+static RUNTIMEOPTIONS options;                                                      // Command line options
+
+static void _SYSEndFrame(void);
+static void _SYSStopApp(void);
+static void _SYSProcessOptions(int argc,char *argv[]);
+
+void MainApplication(void);
+
+/**
+ * @brief      Run the app, or play back a recording in its place.
+ */
+static void _SYSRunApplication(void) {
+    if (options.playFileName != NULL) {
+        RECPlay(options.playFileName);
+    } else {
+        MainApplication();
+    }
+}
 
 /**
  * @brief      Is the app still running (for simulator)
@@ -23,24 +43,235 @@ static int nextUpdateTime = 0;
  * @return     true if the app is still running.
  */
 bool COMAppRunning(void) {
-    return isAppRunning;
+    return __atomic_load_n(&isAppRunning,__ATOMIC_ACQUIRE);
 }
 
 
 /**
- * @brief      Yield, body executed at 50Hz
+ * @brief      Tell the app to stop. The display thread may do this.
+ */
+static void _SYSStopApp(void) {
+    __atomic_store_n(&isAppRunning,false,__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief      Is it time for the next frame ? Frames are paced off the high
+ *             resolution clock, or the virtual clock, so the average rate is
+ *             exactly right. If it falls more than a frame behind it starts
+ *             again from now, rather than trying to catch up.
  *
- * @return     true if 50Hz tick occurred.
+ * @return     true if a frame is due.
+ */
+static bool _SYSFrameDue(void) {
+    uint64_t now = SYSAppClockMicroseconds();
+    if (now < nextFrameTime) return false;
+    uint64_t period = (uint64_t)(1000000.0 / options.frameRate);
+    nextFrameTime += period;
+    if (nextFrameTime <= now) nextFrameTime = now + period;                         // Too far behind.
+    return true;
+}
+
+/**
+ * @brief      Do one frame ; handle events and render, timing it.
+ */
+static void _SYSFrame(void) {
+    SYSTimingBeginFrame();
+    if (SYSPollUpdate() == 0) _SYSStopApp();                                        // Events and redraw
+    _SYSEndFrame();                                                                 // Frame limits and dumps.
+    SYSTimingEndFrame();
+}
+
+/**
+ * @brief      Yield, body executed at the frame rate
+ *
+ * @return     true if a frame tick occurred.
  */
 bool SYSYield(void) {
-    if (COMClock() >= nextUpdateTime) {                                             // So do this to limit the repaint rate to the frame rate.
-        nextUpdateTime = COMClock()+1000/FRAME_RATE;                                // Work out next VSync
-        if (SYSPollUpdate() == 0) isAppRunning = false;                             // Redraw
+    SYSAdvanceClock();                                                              // Virtual time moves on.
+    USBReplayInput();                                                               // Replayed input that is due.
+    if (options.threaded) {                                                         // Display has its own thread.
+        static uint32_t lastFrame = 0;
+        USBProcessQueue();                                                          // Input it has passed over.
+        uint32_t frame = __atomic_load_n(&frameNumber,__ATOMIC_ACQUIRE);            // Has it done a frame since last time ?
+        if (frame == lastFrame) return false;
+        lastFrame = frame;
+        return true;
+    }
+    if (_SYSFrameDue()) {                                                           // So do this to limit the repaint rate to the frame rate.
+        _SYSFrame();
+        USBProcessQueue();                                                          // Dispatch input
         return true;
     }
     return false;
 }
 
+#ifndef HEADLESS
+/**
+ * @brief      The app's thread when the display is threaded, the equivalent of
+ *             core 0.
+ *
+ * @param      data  Not used
+ *
+ * @return     0
+ */
+static int _SYSAppThread(void *data) {
+    _SYSRunApplication();
+    _SYSStopApp();
+    return 0;
+}
+
+/**
+ * @brief      Run with the display on this thread, and the app on its own. This
+ *             thread handles events and renders at each vsync, like core 1 on
+ *             the hardware, and the app does not stop for it.
+ */
+static void _SYSRunThreaded(void) {
+    SDL_Thread *appThread = SDL_CreateThread(_SYSAppThread,"app",NULL);
+    if (appThread == NULL) {
+        exit(printf("Cannot create app thread : %s\n",SDL_GetError()));
+    }
+    while (COMAppRunning()) {
+        if (_SYSFrameDue()) {                                                       // Render at each vsync.
+            _SYSFrame();
+        } else if (nextFrameTime - SYSClockMicroseconds() > 2000) {                 // Sleep if not close to it.
+            SDL_Delay(1);
+        }
+    }
+    SDL_WaitThread(appThread,NULL);                                                 // Let the app finish.
+}
+#endif
+
+/**
+ * @brief      Get the runtime options
+ *
+ * @return     Pointer to options structure.
+ */
+RUNTIMEOPTIONS *SYSGetOptions(void) {
+    return &options;
+}
+
+/**
+ * @brief      Things done at the end of every frame ; dumping frames and
+ *             checking the frame and time limits.
+ */
+static void _SYSEndFrame(void) {
+    bool dump = (options.dumpEvery != 0 && frameNumber % options.dumpEvery == 0);   // Is this frame one to dump ?
+    for (int i = 0;i < options.dumpCount;i++) {
+        if (options.dumpFrames[i] == frameNumber) dump = true;
+    }
+    if (dump) {
+        char fileName[256];
+        snprintf(fileName,sizeof(fileName),options.dumpFileName,frameNumber);
+        if (!RNDWritePPM(fileName)) printf("Cannot write %s\n",fileName);
+    }
+    RECRecordFrame();                                                               // Record it, if recording.
+    __atomic_add_fetch(&frameNumber,1,__ATOMIC_RELEASE);
+    if (options.maxFrames != 0 && frameNumber >= options.maxFrames) _SYSStopApp();
+    if (options.maxTime != 0 && COMClock()-startTime >= options.maxTime) _SYSStopApp();
+}
+
+/**
+ * @brief      Set the display scale from a string, either n (both) or nxm
+ *
+ * @param      scale  Scale string
+ */
+static void _SYSSetScale(char *scale) {
+    char *p;
+    int x = strtol(scale,&p,10),y = x;
+    if (*p == 'x' || *p == 'X') y = strtol(p+1,&p,10);
+    if (*p != '\0' || x < 1 || y < 1) exit(printf("Bad scale %s\n",scale));
+    options.scaleX = x;options.scaleY = y;
+}
+
+/**
+ * @brief      Process the command line options
+ *
+ *             --frames n       stop after n frames
+ *             --ms n           stop after n milliseconds
+ *             --dump n,n,n     dump these frames as PPM
+ *             --dump-every n   dump every n'th frame as PPM
+ *             --dump-file f    printf format for the dump file name (default frame%05d.ppm)
+ *             --benchmark      benchmark the display conversion and TMDS encoders, model the scanout and exit
+ *             --threaded       run the display on its own thread (not with --record or --dump)
+ *             --scale n[xm]    scale the display n times (m times vertically)
+ *             --letterbox      resizable window, largest whole scale that fits
+ *             --fps n          frame rate (default 60)
+ *             --frame-log f    write each frame's times to a CSV file
+ *             --virtual-clock n  virtual clock, advancing n microseconds each yield
+ *             --record f       record the display to a file
+ *             --play f         play a recording instead of running the app
+ *             --record-input f record input to a file
+ *             --replay-input f replay input from a file, ignoring live input
+ *
+ * @param[in]  argc  The count of arguments
+ * @param      argv  The arguments array
+ */
+static void _SYSProcessOptions(int argc,char *argv[]) {
+    options.dumpFileName = "frame%05d.ppm";
+    options.frameRate = FRAME_RATE;
+    options.scaleX = DEFAULT_SCALEX;options.scaleY = DEFAULT_SCALEY;
+    if (getenv("RUNTIME_SCALE") != NULL) _SYSSetScale(getenv("RUNTIME_SCALE"));    // Environment overridden by command line.
+    for (int i = 1;i < argc;i++) {
+        char *arg = argv[i];
+        if (strcmp(arg,"--benchmark") == 0) {                                      // Options without a parameter.
+            options.benchmark = true;
+            continue;
+        }
+        if (strcmp(arg,"--letterbox") == 0) {
+            options.letterbox = true;
+            continue;
+        }
+        if (strcmp(arg,"--threaded") == 0) {
+            #ifdef HEADLESS
+            printf("--threaded has no effect without a display\n");
+            #else
+            options.threaded = true;
+            #endif
+            continue;
+        }
+        char *param = (i+1 < argc) ? argv[i+1] : NULL;                              // Everything else has a parameter.
+        if (param == NULL) {
+            exit(printf("Option %s requires a parameter\n",arg));
+        }
+        if (strcmp(arg,"--frames") == 0) {
+            options.maxFrames = atoi(param);
+        } else if (strcmp(arg,"--ms") == 0) {
+            options.maxTime = atoi(param);
+        } else if (strcmp(arg,"--dump-every") == 0) {
+            options.dumpEvery = atoi(param);
+        } else if (strcmp(arg,"--scale") == 0) {
+            _SYSSetScale(param);
+        } else if (strcmp(arg,"--fps") == 0) {
+            options.frameRate = atof(param);
+            if (options.frameRate <= 0) exit(printf("Bad frame rate %s\n",param));
+        } else if (strcmp(arg,"--virtual-clock") == 0) {
+            options.virtualClockStep = atoi(param);
+            if (options.virtualClockStep == 0) exit(printf("Bad virtual clock step %s\n",param));
+        } else if (strcmp(arg,"--record") == 0) {
+            options.recordFileName = param;
+        } else if (strcmp(arg,"--play") == 0) {
+            options.playFileName = param;
+        } else if (strcmp(arg,"--record-input") == 0) {
+            options.recordInputFileName = param;
+        } else if (strcmp(arg,"--replay-input") == 0) {
+            options.replayInputFileName = param;
+        } else if (strcmp(arg,"--frame-log") == 0) {
+            options.frameLogFileName = param;
+        } else if (strcmp(arg,"--dump-file") == 0) {
+            options.dumpFileName = param;
+        } else if (strcmp(arg,"--dump") == 0) {
+            char *p = param;                                                        // Comma seperated list of frames.
+            while (*p != '\0' && options.dumpCount < MAX_DUMP_FRAMES) {
+                options.dumpFrames[options.dumpCount++] = strtol(p,&p,10);
+                if (*p == ',') p++;
+            }
+        } else {
+            exit(printf("Unknown option %s\n",arg));
+        }
+        i++;                                                                        // Skip the parameter
+    }
+}
+
 /**
  * @brief      Main program.
  *
@@ -50,11 +281,44 @@ bool SYSYield(void) {
  * @return     { description_of_the_return_value }
  */
 
-void MainApplication(void);
-
 int main(int argc,char *argv[]) {
+    _SYSProcessOptions(argc,argv);                                                  // Command line options
+    if (options.benchmark) {                                                        // Benchmark rather than run.
+        RNDBenchmarkConversion();
+        RNDBenchmarkTMDS();
+        RNDModelScanout();
+        return(0);
+    }
+    if (options.virtualClockStep != 0) {                                            // Virtual clock, which needs the app to drive the display.
+        SYSSetVirtualClock(options.virtualClockStep);
+        if (options.threaded) printf("--threaded is ignored with a virtual clock\n");
+        options.threaded = false;
+    }
+    if (options.threaded && (options.recordFileName != NULL || options.dumpEvery != 0 || options.dumpCount != 0)) {
+        exit(printf("--record and --dump read the display between app frames, so cannot be used with --threaded\n"));
+    }
     SYSOpen(false);                                                                 // Start SDL and Mouse/Controller/Sound that use it
-    MainApplication();                                                              // Run the program
+    startTime = COMClock();
+    SYSTimingStart(options.frameLogFileName);                                       // Frame timing
+    if (options.recordFileName != NULL) RECStartRecording(options.recordFileName);
+    if (options.recordInputFileName != NULL) USBStartInputRecording(options.recordInputFileName);
+    if (options.replayInputFileName != NULL) USBStartInputReplay(options.replayInputFileName);
+    #ifndef HEADLESS
+    if (options.threaded) {                                                         // Run the program, display on this thread
+        _SYSRunThreaded();
+    } else {
+        _SYSRunApplication();                                                       // Run the program
+    }
+    #else
+    _SYSRunApplication();                                                           // Run the program
+    #endif
+    RECEndRecording();
+    USBEndInputRecording();
     SYSClose();                                                                     // Close down
+    SYSTimingReport(options.frameRate);
+    SYSProfileReport();
+    #ifdef PSRAM_CACHE_MODEL
+    PSRCacheReport();
+    #endif
     return(0);
 }
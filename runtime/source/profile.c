@@ -0,0 +1,127 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      profile.c
+//      Purpose :   Profiling of update functions, VDU commands and PLOT commands.
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+
+static COMPROFILE profile[PROFILE_GROUPS][PROFILE_ENTRIES];
+
+#ifdef PROFILE
+/**
+ * @brief      Profiling clock.
+ *
+ * @return     Time in nanoseconds.
+ */
+uint64_t COMProfileClock(void) {
+    #ifdef HEADLESS
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    #else
+    static double scale = 0;
+    if (scale == 0) scale = 1000000000.0 / SDL_GetPerformanceFrequency();
+    return (uint64_t)(SDL_GetPerformanceCounter() * scale);
+    #endif
+}
+
+/**
+ * @brief      Record the time for one call.
+ *
+ * @param[in]  group      Group (PROFILE_xxx)
+ * @param[in]  index      Entry in the group
+ * @param[in]  startTime  COMProfileClock() when it started.
+ */
+void COMProfileRecord(int group,int index,uint64_t startTime) {
+    if (group < 0 || group >= PROFILE_GROUPS || index < 0 || index >= PROFILE_ENTRIES) return;
+    uint64_t elapsed = COMProfileClock() - startTime;
+    COMPROFILE *p = &profile[group][index];
+    p->calls++;
+    p->totalTime += elapsed;
+    if (elapsed > p->maxTime) p->maxTime = elapsed;
+}
+#endif
+
+/**
+ * @brief      Get profiling information.
+ *
+ * @param[in]  group   Group (PROFILE_xxx)
+ * @param[in]  index   Entry in the group
+ * @param      result  Where the information goes
+ *
+ * @return     true if profiling is enabled, and the group/index is valid.
+ */
+bool COMProfileGet(int group,int index,COMPROFILE *result) {
+    #ifdef PROFILE
+    if (group < 0 || group >= PROFILE_GROUPS || index < 0 || index >= PROFILE_ENTRIES) return false;
+    *result = profile[group][index];
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+/**
+ * @brief      Clear all profiling information.
+ */
+void COMProfileReset(void) {
+    memset(profile,0,sizeof(profile));
+}
+
+#ifdef PROFILE
+/**
+ * @brief      Name of a profile entry.
+ *
+ * @param[in]  group   Group
+ * @param[in]  index   Entry in the group
+ * @param      buffer  Where the name goes
+ * @param[in]  size    Size of the buffer
+ */
+static void _SYSProfileName(int group,int index,char *buffer,int size) {
+    switch(group) {
+        case PROFILE_UPDATE:
+            if (index == PROFILE_YIELD) snprintf(buffer,size,"SYSYield");
+            else snprintf(buffer,size,"Update function %d",index);
+            break;
+        case PROFILE_VDU:
+            if (index == 32) snprintf(buffer,size,"VDU text");
+            else snprintf(buffer,size,"VDU %d",index);
+            break;
+        case PROFILE_PLOT:
+            snprintf(buffer,size,"PLOT %d-%d",index*8,index*8+7);
+            break;
+    }
+}
+#endif
+
+/**
+ * @brief      Print the profile table, most time first in each group.
+ */
+void SYSProfileReport(void) {
+    #ifdef PROFILE
+    printf("%-20s %10s %12s %10s %10s\n","Profile","Calls","Total ms","Mean us","Max us");
+    for (int g = 0;g < PROFILE_GROUPS;g++) {
+        bool done[PROFILE_ENTRIES] = { false };
+        while (true) {                                                              // Print in order of total time.
+            int best = -1;
+            for (int i = 0;i < PROFILE_ENTRIES;i++) {
+                if (!done[i] && profile[g][i].calls != 0 &&
+                            (best < 0 || profile[g][i].totalTime > profile[g][best].totalTime)) best = i;
+            }
+            if (best < 0) break;
+            done[best] = true;
+            COMPROFILE *p = &profile[g][best];
+            char name[32];
+            _SYSProfileName(g,best,name,sizeof(name));
+            printf("%-20s %10u %12.3f %10.3f %10.3f\n",name,p->calls,p->totalTime/1e6,
+                                                    p->totalTime/1e3/p->calls,p->maxTime/1e3);
+        }
+    }
+    #endif
+}
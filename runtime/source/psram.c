@@ -22,4 +22,126 @@ uint8_t *PSRGetMemoryAddress(void) {
 
 uint32_t PSRGetMemorySize(void) {
     return sizeof(fakePSRAM);
-}
\ No newline at end of file
+}
+
+#ifdef PSRAM_CACHE_MODEL
+
+//
+//      Model of the RP2350 XIP cache in front of the PSRAM : 16k, 2 way set associative, 8 byte lines, write
+//      allocate and write back. The stall costs are estimates for QSPI PSRAM at half the system clock ; a
+//      line fill is the command, address, wait states and 8 bytes of data, a write back is the same less the
+//      wait states.
+//
+#define CACHE_SIZE          (16384)
+#define CACHE_WAYS          (2)
+#define CACHE_LINE          (8)
+#define CACHE_SETS          (CACHE_SIZE / CACHE_WAYS / CACHE_LINE)
+
+#define MISS_CYCLES         (60)                                                    // Estimated stall for a line fill
+#define WRITEBACK_CYCLES    (48)                                                    // Estimated stall for writing a dirty line back.
+
+typedef struct _cacheLine {
+    uint32_t tag;                                                                   // Line address (address / CACHE_LINE)
+    bool isValid,isDirty;
+    uint32_t lastUsed;                                                              // For least recently used replacement.
+} CACHELINE;
+
+typedef struct _callSite {
+    const char *file;int line;                                                      // Where the access is in the source.
+    uint64_t reads,writes,hits,misses,writeBacks;
+} CALLSITE;
+
+#define MAX_CALL_SITES      (256)
+
+static CACHELINE cache[CACHE_SETS][CACHE_WAYS];
+static CALLSITE sites[MAX_CALL_SITES];
+static int siteCount = 0;
+static uint32_t useCounter = 0;
+
+/**
+ * @brief      Find the record for a call site, creating it if new.
+ *
+ * @param      file  Source file
+ * @param[in]  line  Line number
+ *
+ * @return     Call site record.
+ */
+static CALLSITE *_PSRFindSite(const char *file,int line) {
+    static CALLSITE overflow = { "(other)",0 };
+    for (int i = 0;i < siteCount;i++) {
+        if (sites[i].line == line && sites[i].file == file) return &sites[i];
+    }
+    if (siteCount == MAX_CALL_SITES) return &overflow;
+    sites[siteCount].file = file;sites[siteCount].line = line;
+    return &sites[siteCount++];
+}
+
+/**
+ * @brief      Model an access to PSRAM through the cache. Accesses outside
+ *             PSRAM are ignored.
+ *
+ * @param      address  Address accessed
+ * @param[in]  size     Bytes accessed
+ * @param[in]  isWrite  true if written
+ * @param      file     Source file of the access
+ * @param[in]  line     Line number of the access
+ */
+void PSRCacheAccess(const void *address,uint32_t size,bool isWrite,const char *file,int line) {
+    const uint8_t *p = (const uint8_t *)address;
+    if (p < fakePSRAM || p+size > fakePSRAM+sizeof(fakePSRAM) || size == 0) return;
+    CALLSITE *site = _PSRFindSite(file,line);
+    if (isWrite) site->writes++; else site->reads++;
+    uint32_t offset = p - fakePSRAM;
+    for (uint32_t tag = offset / CACHE_LINE;tag <= (offset+size-1) / CACHE_LINE;tag++) {
+        CACHELINE *set = cache[tag % CACHE_SETS];
+        CACHELINE *line = NULL;
+        for (int w = 0;w < CACHE_WAYS;w++) {                                        // Look for it.
+            if (set[w].isValid && set[w].tag == tag) line = &set[w];
+        }
+        if (line != NULL) {
+            site->hits++;
+        } else {
+            site->misses++;                                                         // Replace the least recently used.
+            line = &set[0];
+            for (int w = 1;w < CACHE_WAYS;w++) {
+                if (!set[w].isValid || (line->isValid && set[w].lastUsed < line->lastUsed)) line = &set[w];
+            }
+            if (line->isValid && line->isDirty) site->writeBacks++;
+            line->tag = tag;line->isValid = true;line->isDirty = false;
+        }
+        line->lastUsed = ++useCounter;
+        if (isWrite) line->isDirty = true;
+    }
+}
+
+/**
+ * @brief      Sort call sites, most stall cycles first.
+ */
+static int _PSRCompareSites(const void *a,const void *b) {
+    const CALLSITE *sa = a,*sb = b;
+    uint64_t ca = sa->misses*MISS_CYCLES+sa->writeBacks*WRITEBACK_CYCLES;
+    uint64_t cb = sb->misses*MISS_CYCLES+sb->writeBacks*WRITEBACK_CYCLES;
+    return (ca < cb) - (ca > cb);
+}
+
+/**
+ * @brief      Print the cache statistics for each call site.
+ */
+void PSRCacheReport(void) {
+    if (siteCount == 0) return;
+    qsort(sites,siteCount,sizeof(CALLSITE),_PSRCompareSites);
+    printf("PSRAM cache model : %dk %d way, %d byte lines\n",CACHE_SIZE/1024,CACHE_WAYS,CACHE_LINE);
+    printf("%-40s %10s %10s %10s %10s %10s %12s\n","Call site","Reads","Writes","Hits","Misses","Writebacks","Stall cycles");
+    for (int i = 0;i < siteCount;i++) {
+        CALLSITE *s = &sites[i];
+        const char *name = strrchr(s->file,'/');                                    // Just the file name.
+        char where[64];
+        snprintf(where,sizeof(where),"%s:%d",name == NULL ? s->file : name+1,s->line);
+        printf("%-40s %10llu %10llu %10llu %10llu %10llu %12llu\n",where,
+                (unsigned long long)s->reads,(unsigned long long)s->writes,(unsigned long long)s->hits,
+                (unsigned long long)s->misses,(unsigned long long)s->writeBacks,
+                (unsigned long long)(s->misses*MISS_CYCLES+s->writeBacks*WRITEBACK_CYCLES));
+    }
+}
+
+#endif
@@ -0,0 +1,372 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      recording.c
+//      Purpose :   Record and play back the display as a delta compressed stream.
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+
+//
+//      The file starts with a header (the magic string, a version byte and VIDEO_BYTES as 4 bytes, low first)
+//      followed by one record for each frame. The framebuffer starts off as all zero.
+//
+//          'M' <mode>              The display mode changed (before this frame), followed by the frame. This
+//                                  also resets the palette to the mode's default.
+//          'P' <n> <r> <g> <b>     Palette entry n changed (before this frame).
+//          'Y' <offset>            The vertical scroll offset changed (before this frame). 'M' sets it to 0.
+//          'D' <page>              The display page changed (before this frame). 'M' sets it to 0.
+//          'R' <count> <entries>   The raster list changed (before this frame), each entry is <line> <action> and
+//                                  the value as 4 bytes, low first. 'M' removes it.
+//          'K' <n> <sprite>        Sprite n changed (before this frame), <x> <y> as 2 bytes each, low first, then
+//                                  <width> <height> <depth> <colour> <has mask>, the image words then any mask words,
+//                                  as 4 bytes each, low first. A width of 0 means it is not shown. 'M' removes them.
+//                                  Sprite DVI_POINTER_SPRITE is the mouse pointer, which 'M' does not remove.
+//          'J' <n> <x> <y>         Sprite n moved (before this frame), as in 'K'.
+//          'S'                     Frame, the same as the last one.
+//          'F' <tokens>            Frame. Each token is <skip> <count> <count bytes>, meaning skip that many bytes
+//                                  then XOR the following bytes into the framebuffer, until the end of framebuf.
+//
+//      <offset>, <line>, <skip> and <count> are unsigned LEB128 (7 bits at a time, low first, bit 7 set if more follows).
+//
+#define REC_MAGIC       "RPFB"
+#define REC_VERSION     (6)                                                         // 2 palette, 3 scroll offset, 4 raster list, 5 display page, 6 sprites.
+
+#define REC_MERGE_GAP   (4)                                                         // Unchanged runs shorter than this are included in literals.
+#define REC_SPRITE_WORDS (DVI_SPRITE_SIZE * 4)                                      // Most image and mask words in a sprite.
+
+static FILE *recordFile = NULL;                                                     // Recording to this.
+static uint8_t previous[VIDEO_BYTES];                                               // Framebuffer at the last frame.
+static uint8_t encoded[VIDEO_BYTES * 2 + DVI_PALETTE_SIZE * 5 + DVI_MAX_RASTER * 8 + // Encoded frame, worst case is < 2 x size, the palette,
+                        DVI_SPRITE_ENTRIES * (11 + REC_SPRITE_WORDS * 4)];          // raster list and sprites.
+static int lastMode = -1;                                                           // Mode at last frame.
+static uint32_t lastPalette[DVI_PALETTE_SIZE];                                      // Palette at last frame.
+static uint32_t lastOffset = 0;                                                     // Scroll offset at last frame.
+static uint32_t lastPage = 0;                                                       // Display page at last frame.
+static DVIRASTERENTRY lastRaster[DVI_MAX_RASTER];                                   // Raster list at last frame.
+static int lastRasterCount = 0;
+static DVISPRITE lastSprites[DVI_SPRITE_ENTRIES];                                   // Sprites at last frame, and their images.
+static uint32_t lastSpriteWords[DVI_SPRITE_ENTRIES][REC_SPRITE_WORDS];
+static uint64_t recordedFrames = 0,recordedBytes = 0;
+
+/**
+ * @brief      Write an unsigned LEB128 value.
+ *
+ * @param      p      Where to write it
+ * @param[in]  value  Value to write
+ *
+ * @return     Position after it.
+ */
+static uint8_t *_RECWriteNumber(uint8_t *p,uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *p++ = value;
+    return p;
+}
+
+/**
+ * @brief      Read an unsigned LEB128 value.
+ *
+ * @param      f      File to read from
+ *
+ * @return     The value.
+ */
+static uint32_t _RECReadNumber(FILE *f) {
+    uint32_t value = 0;
+    int shift = 0,c;
+    do {
+        c = fgetc(f);
+        if (c == EOF) return 0;
+        value |= (c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return value;
+}
+
+/**
+ * @brief      Find the next difference between framebuf and previous. Whole 64
+ *             bit words are compared first, as most of the display does not
+ *             change.
+ *
+ * @param[in]  pos   Position to start
+ *
+ * @return     Position of the next changed byte, VIDEO_BYTES if none.
+ */
+static uint32_t _RECNextChange(uint32_t pos) {
+    while (pos < VIDEO_BYTES && (pos & 7) != 0 && framebuf[pos] == previous[pos]) pos++;
+    while (pos+8 <= VIDEO_BYTES) {
+        uint64_t a,b;
+        memcpy(&a,framebuf+pos,8);memcpy(&b,previous+pos,8);
+        if (a != b) break;
+        pos += 8;
+    }
+    while (pos < VIDEO_BYTES && framebuf[pos] == previous[pos]) pos++;
+    return pos;
+}
+
+/**
+ * @brief      Start recording
+ *
+ * @param      fileName  File to record to.
+ */
+void RECStartRecording(char *fileName) {
+    recordFile = fopen(fileName,"wb");
+    if (recordFile == NULL) exit(printf("Cannot create %s\n",fileName));
+    fwrite(REC_MAGIC,1,4,recordFile);
+    uint8_t header[5] = { REC_VERSION,VIDEO_BYTES & 0xFF,(VIDEO_BYTES >> 8) & 0xFF,(VIDEO_BYTES >> 16) & 0xFF,VIDEO_BYTES >> 24 };
+    fwrite(header,1,5,recordFile);
+    memset(previous,0,sizeof(previous));
+    lastMode = -1;
+}
+
+/**
+ * @brief      Get a sprite's image and mask words, one after the other.
+ *
+ * @param[in]  s      Sprite
+ * @param      words  Buffer for them, REC_SPRITE_WORDS long.
+ *
+ * @return     Number of words, 0 if it is not shown.
+ */
+static int _RECSpriteWords(const DVISPRITE *s,uint32_t *words) {
+    if (!s->isVisible) return 0;
+    int count = 0;
+    for (int i = 0;i < s->height * s->depth;i++) words[count++] = s->image[i];
+    if (s->mask != NULL) {
+        for (int i = 0;i < s->height;i++) words[count++] = s->mask[i];
+    }
+    return count;
+}
+
+/**
+ * @brief      Record the sprites that have changed since the last frame.
+ *
+ * @param      p     Where to write them.
+ *
+ * @return     Next free byte.
+ */
+static uint8_t *_RECRecordSprites(uint8_t *p) {
+    for (int n = 0;n < DVI_SPRITE_ENTRIES;n++) {
+        DVISPRITE s,*last = &lastSprites[n];
+        uint32_t words[REC_SPRITE_WORDS];
+        DVIGetSprite(n,&s);
+        int count = _RECSpriteWords(&s,words);
+        bool changed = s.isVisible != last->isVisible;                              // Compared by field, there is padding.
+        if (s.isVisible && !changed) {
+            changed = s.width != last->width || s.height != last->height || s.depth != last->depth ||
+                                s.colour != last->colour || (s.mask == NULL) != (last->mask == NULL) ||
+                                memcmp(words,lastSpriteWords[n],count * sizeof(uint32_t)) != 0;
+        }
+        if (changed) {                                                              // Sprite changed, all of it.
+            *p++ = 'K';*p++ = n;
+            *p++ = s.x;*p++ = s.x >> 8;*p++ = s.y;*p++ = s.y >> 8;
+            *p++ = s.isVisible ? s.width : 0;*p++ = s.height;*p++ = s.depth;*p++ = s.colour;*p++ = (s.mask != NULL);
+            for (int i = 0;i < count;i++) {
+                for (int b = 0;b < 4;b++) *p++ = words[i] >> (b*8);
+            }
+        } else if (s.isVisible && (s.x != last->x || s.y != last->y)) {             // Only moved.
+            *p++ = 'J';*p++ = n;
+            *p++ = s.x;*p++ = s.x >> 8;*p++ = s.y;*p++ = s.y >> 8;
+        }
+        *last = s;
+        memcpy(lastSpriteWords[n],words,count * sizeof(uint32_t));
+    }
+    return p;
+}
+
+/**
+ * @brief      Record a frame, called at the end of every frame.
+ */
+void RECRecordFrame(void) {
+    if (recordFile == NULL) return;
+    uint8_t *p = encoded;
+    DVIMODEINFO *dm = DVIGetModeInformation();
+    int mode = dm->mode;
+    if (mode != lastMode) {                                                         // Mode changed
+        *p++ = 'M';*p++ = mode;
+        lastMode = mode;lastOffset = 0;lastPage = 0;lastRasterCount = 0;
+        for (int n = 0;n < DVI_MAX_SPRITES;n++) lastSprites[n].isVisible = false;   // The pointer stays.
+        for (int i = 0;i < DVI_PALETTE_SIZE;i++) lastPalette[i] = DVIGetDefaultPalette(i);
+    }
+    for (int i = 0;i < DVI_PALETTE_SIZE;i++) {                                      // Palette changes.
+        uint32_t rgb = DVIGetPalette(i);
+        if (rgb != lastPalette[i]) {
+            *p++ = 'P';*p++ = i;*p++ = rgb >> 16;*p++ = rgb >> 8;*p++ = rgb;
+            lastPalette[i] = rgb;
+        }
+    }
+    if (dm->yOffset != lastOffset) {                                                // Scroll offset changed.
+        *p++ = 'Y';p = _RECWriteNumber(p,dm->yOffset);
+        lastOffset = dm->yOffset;
+    }
+    if (dm->displayPage != lastPage) {                                              // Display page changed.
+        *p++ = 'D';*p++ = dm->displayPage;
+        lastPage = dm->displayPage;
+    }
+    DVIRASTERENTRY raster[DVI_MAX_RASTER];
+    int rasterCount = DVIGetRasterList(raster);
+    bool rasterChanged = (rasterCount != lastRasterCount);
+    for (int i = 0;i < rasterCount && !rasterChanged;i++) {                         // Compared by field, there is padding.
+        rasterChanged = raster[i].line != lastRaster[i].line || raster[i].action != lastRaster[i].action ||
+                                                                        raster[i].value != lastRaster[i].value;
+    }
+    if (rasterChanged) {
+        *p++ = 'R';*p++ = rasterCount;                                              // Raster list changed.
+        for (int i = 0;i < rasterCount;i++) {
+            p = _RECWriteNumber(p,raster[i].line);*p++ = raster[i].action;
+            for (int b = 0;b < 4;b++) *p++ = raster[i].value >> (b*8);
+        }
+        memcpy(lastRaster,raster,sizeof(raster));lastRasterCount = rasterCount;
+    }
+    p = _RECRecordSprites(p);
+    uint32_t pos = _RECNextChange(0);
+    if (pos == VIDEO_BYTES) {                                                       // Nothing has changed.
+        *p++ = 'S';
+    } else {
+        *p++ = 'F';
+        uint32_t last = 0;                                                          // End of the last literal
+        while (pos < VIDEO_BYTES) {
+            uint32_t end = pos;                                                     // Find the end of the changed run, merging short gaps.
+            do {
+                while (end < VIDEO_BYTES && framebuf[end] != previous[end]) end++;
+                uint32_t next = _RECNextChange(end);
+                if (next == VIDEO_BYTES || next-end >= REC_MERGE_GAP) break;
+                end = next;
+            } while (true);
+            p = _RECWriteNumber(p,pos-last);                                        // Skip, count and the XOR values.
+            p = _RECWriteNumber(p,end-pos);
+            for (uint32_t i = pos;i < end;i++) {
+                *p++ = framebuf[i] ^ previous[i];
+                previous[i] = framebuf[i];
+            }
+            last = end;
+            pos = _RECNextChange(end);
+        }
+        if (last != VIDEO_BYTES) {                                                  // Skip to the end.
+            p = _RECWriteNumber(p,VIDEO_BYTES-last);
+            p = _RECWriteNumber(p,0);
+        }
+    }
+    fwrite(encoded,1,p-encoded,recordFile);
+    recordedFrames++;recordedBytes += p-encoded;
+}
+
+/**
+ * @brief      Finish recording.
+ */
+void RECEndRecording(void) {
+    if (recordFile == NULL) return;
+    fclose(recordFile);
+    recordFile = NULL;
+    printf("Recorded %llu frames, %llu bytes, %.1f bytes per frame\n",(unsigned long long)recordedFrames,
+                    (unsigned long long)recordedBytes,recordedFrames == 0 ? 0.0 : (double)recordedBytes/recordedFrames);
+}
+
+/**
+ * @brief      Play back a recording, in place of the app. Each frame is shown
+ *             for one frame, so it can be watched, or dumped with the --dump
+ *             options.
+ *
+ * @param      fileName  Recording to play.
+ */
+void RECPlay(char *fileName) {
+    static uint32_t playSpriteWords[DVI_SPRITE_ENTRIES][REC_SPRITE_WORDS];         // Images of the sprites being played.
+    FILE *f = fopen(fileName,"rb");
+    if (f == NULL) exit(printf("Cannot open %s\n",fileName));
+    uint8_t header[9];
+    if (fread(header,1,9,f) != 9 || memcmp(header,REC_MAGIC,4) != 0 || header[4] > REC_VERSION) {
+        exit(printf("%s is not a recording\n",fileName));
+    }
+    if ((header[5] | (header[6] << 8) | (header[7] << 16) | (header[8] << 24)) != VIDEO_BYTES) {
+        exit(printf("%s was recorded with a different framebuffer size\n",fileName));
+    }
+    DVIInitialise();
+    memset(framebuf,0,VIDEO_BYTES);                                                 // Starts off all zero.
+    int c;
+    while (COMAppRunning() && (c = fgetc(f)) != EOF) {
+        if (c == 'M') {                                                             // Mode change
+            DVISetMode(fgetc(f));
+            continue;
+        }
+        if (c == 'P') {                                                             // Palette change
+            int n = fgetc(f),r = fgetc(f),g = fgetc(f),b = fgetc(f);
+            DVISetPalette(n,(r << 16) | (g << 8) | b);
+            continue;
+        }
+        if (c == 'Y') {                                                             // Scroll offset change
+            DVISetScrollOffset(_RECReadNumber(f));
+            continue;
+        }
+        if (c == 'D') {                                                             // Display page change
+            DVISetDisplayPage(fgetc(f));
+            continue;
+        }
+        if (c == 'R') {                                                             // Raster list change
+            DVIRASTERENTRY raster[DVI_MAX_RASTER];
+            int count = fgetc(f);
+            if (count < 0 || count > DVI_MAX_RASTER) exit(printf("%s is corrupt\n",fileName));
+            for (int i = 0;i < count;i++) {
+                raster[i].line = _RECReadNumber(f);raster[i].action = fgetc(f);raster[i].value = 0;
+                for (int b = 0;b < 4;b++) raster[i].value |= (uint32_t)fgetc(f) << (b*8);
+            }
+            DVISetRasterList(raster,count);
+            continue;
+        }
+        if (c == 'K') {                                                             // Sprite change
+            int n = fgetc(f);
+            if (n < 0 || n >= DVI_SPRITE_ENTRIES) exit(printf("%s is corrupt\n",fileName));
+            DVISPRITE s;
+            s.x = fgetc(f);s.x |= fgetc(f) << 8;s.y = fgetc(f);s.y |= fgetc(f) << 8;
+            s.width = fgetc(f);s.height = fgetc(f);s.depth = fgetc(f);s.colour = fgetc(f);
+            bool hasMask = fgetc(f) != 0;
+            s.isVisible = true;s.image = playSpriteWords[n];
+            s.mask = hasMask ? playSpriteWords[n] + s.height * s.depth : NULL;
+            if (s.width == 0) {                                                     // Not shown.
+                if (n == DVI_POINTER_SPRITE) DVIShowPointer(false); else DVISetSprite(n,NULL);
+                continue;
+            }
+            int count = s.height * s.depth + (hasMask ? s.height : 0);
+            if (s.height > DVI_SPRITE_SIZE || s.depth > 3 || count > REC_SPRITE_WORDS) exit(printf("%s is corrupt\n",fileName));
+            for (int i = 0;i < count;i++) {
+                playSpriteWords[n][i] = 0;
+                for (int b = 0;b < 4;b++) playSpriteWords[n][i] |= (uint32_t)fgetc(f) << (b*8);
+            }
+            if (n == DVI_POINTER_SPRITE) {                                          // The pointer, with the hot spot at 0,0
+                DVISetPointer(s.image,s.mask,0,0);
+                DVIMovePointer(s.x,s.y);DVIShowPointer(true);
+            } else {
+                DVISetSprite(n,&s);
+            }
+            continue;
+        }
+        if (c == 'J') {                                                             // Sprite moved
+            int n = fgetc(f);
+            int x = fgetc(f);x |= fgetc(f) << 8;
+            int y = fgetc(f);y |= fgetc(f) << 8;
+            if (n == DVI_POINTER_SPRITE) DVIMovePointer((int16_t)x,(int16_t)y); else DVIMoveSprite(n,(int16_t)x,(int16_t)y);
+            continue;
+        }
+        if (c == 'F') {                                                             // Changed frame.
+            uint32_t pos = 0;
+            while (pos < VIDEO_BYTES) {
+                uint32_t skip = _RECReadNumber(f);
+                uint32_t count = _RECReadNumber(f);
+                if (skip == 0 && count == 0) exit(printf("%s is corrupt\n",fileName));
+                pos += skip;
+                if (pos+count > VIDEO_BYTES) exit(printf("%s is corrupt\n",fileName));
+                for (uint32_t i = 0;i < count;i++) framebuf[pos+i] ^= fgetc(f);
+                pos += count;
+            }
+            DVIMarkAllDirty();
+        } else if (c != 'S') {
+            exit(printf("%s is corrupt\n",fileName));
+        }
+        while (COMAppRunning() && !SYSYield()) {}                                   // Show it for one frame.
+    }
+    fclose(f);
+}
@@ -12,6 +12,7 @@
 #include <runtime.h>
 
 uint8_t framebuf[VIDEO_BYTES];                                                      // Bitplane memory
+volatile uint32_t dvi_frameCount = 0;                                               // Frames displayed, the vsync count.
 
 //
 //      Palettes for 8 colour and 64 colour mode
@@ -39,6 +40,32 @@ static int palette_64[64] = {
     0x0AF, 0x5AF, 0xAAF, 0xFAF,
     0x0FF, 0x5FF, 0xAFF, 0xFFF,
 };
+//
+//      ARGB versions of the palettes.
+//
+static uint32_t argb_8[8],argb_64[64];
+
+#ifndef HEADLESS
+static uint32_t displayBuffer[FRAME_WIDTH*FRAME_HEIGHT];                            // Packed ARGB version of the display.
+#endif
+
+//
+//      The dirty line bits are set by the app and taken by the renderer, which may be on another thread, so
+//      they are accessed atomically.
+//
+static uint32_t dirtyLines[FRAME_HEIGHT/32];                                        // One bit per framebuffer line, set when changed.
+static bool anyDirty;                                                               // Set if any bit in dirtyLines is set.
+
+#ifndef HEADLESS
+static uint8_t snapshotBuffer[VIDEO_BYTES];                                         // Copy of framebuf taken at vsync.
+static DVIMODEINFO snapshotMode;                                                    // Mode information for it.
+static DVIRASTERENTRY snapshotRaster[DVI_MAX_RASTER];                               // And the raster list.
+static int snapshotRasterCount;
+static DVISPRITE snapshotSprites[DVI_SPRITE_ENTRIES];                               // And the sprites and pointer.
+#endif
+
+#define TOARGB(x) (0xFF000000 | ((((x) >> 8) & 0xF) * 0x110000) | ((((x) >> 4) & 0xF) * 0x1100) | (((x) & 0xF) * 0x11))
+
 /**
  * @brief      Initialise the rendering system. This means creating working
  *             palettes ready to go for the different renderer. The mono palette
@@ -46,46 +73,236 @@ static int palette_64[64] = {
  */
 void DVIInitialise(void) { 
     for (int i = 0;i < VIDEO_BYTES;i++) framebuf[i] = rand();   
+    for (int i = 0;i < 8;i++) argb_8[i] = TOARGB(palette_8[i]);                     // Convert the palettes to the texture format.
+    for (int i = 0;i < 64;i++) argb_64[i] = TOARGB(palette_64[i]);
+    RNDInitialiseConversion();                                                      // Set up the planar to chunky converter.
+    DVIMarkAllDirty();
 }
 
+/**
+ * @brief      Mark framebuffer lines as changed, so they are converted on the
+ *             next render.
+ *
+ * @param[in]  yFrom  First line (0 is the top)
+ * @param[in]  yTo    Last line, inclusive.
+ */
+void DVIMarkDirty(int yFrom,int yTo) {
+    if (yFrom > yTo) { int n = yFrom;yFrom = yTo;yTo = n; }                         // Put them in order
+    if (yFrom < 0) yFrom = 0;                                                       // Clip to the frame
+    if (yTo >= FRAME_HEIGHT) yTo = FRAME_HEIGHT-1;
+    if (yFrom > yTo) return;
+    for (int w = yFrom >> 5;w <= (yTo >> 5);w++) {                                  // Set the bits a word at a time.
+        uint32_t mask = 0xFFFFFFFF;
+        if (w == (yFrom >> 5)) mask &= 0xFFFFFFFF << (yFrom & 31);
+        if (w == (yTo >> 5)) mask &= 0xFFFFFFFF >> (31-(yTo & 31));
+        __atomic_fetch_or(&dirtyLines[w],mask,__ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&anyDirty,true,__ATOMIC_RELEASE);
+}
 
 /**
- * @brief      Render the display
+ * @brief      Mark the whole display as changed, e.g. on a mode change.
+ */
+void DVIMarkAllDirty(void) {
+    for (int w = 0;w < FRAME_HEIGHT/32;w++) __atomic_store_n(&dirtyLines[w],0xFFFFFFFF,__ATOMIC_RELEASE);
+    __atomic_store_n(&anyDirty,true,__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief      Get the scroll offset for a display line, which the raster list
+ *             may change part way down, as the scanout does.
+ *
+ * @param      dm      Mode information
+ * @param      raster  Raster list
+ * @param[in]  count   Entries in it
+ * @param[in]  y       Line number
+ *
+ * @return     Scroll offset
+ */
+static uint32_t _RNDRasterOffset(DVIMODEINFO *dm,DVIRASTERENTRY *raster,int count,int y) {
+    uint32_t yOffset = dm->yOffset;
+    for (int i = 0;i < count && raster[i].line <= y;i++) {
+        if (raster[i].action == DVI_RASTER_OFFSET) yOffset = raster[i].value % dm->height;
+    }
+    return yOffset;
+}
+
+/**
+ * @brief      Draw the sprites on a line of colour indices, as the scanout does
+ *             on the bitplanes.
  *
- * @param      surface  The surface to render it on
+ * @param      dm       Mode information
+ * @param      sprites  Sprite table
+ * @param[in]  y        Line number
+ * @param      pixels   Colour indices, dm->width of them.
  */
-void RNDRender(SDL_Surface *surface) {  
+static void _RNDDrawSprites(DVIMODEINFO *dm,const DVISPRITE *sprites,int y,uint8_t *pixels) {
+    for (int n = 0;n < DVI_SPRITE_ENTRIES;n++) {                                    // Lowest numbered first, the pointer last.
+        const DVISPRITE *s = &sprites[n];
+        if (!s->isVisible || y < s->y || y >= s->y + s->height) continue;
+        int row = y - s->y;
+        uint32_t planes[3];
+        for (int p = 0;p < 3;p++) planes[p] = (s->depth == 1) ? s->image[row] : s->image[p * s->height + row];
+        uint32_t mask = (s->mask != NULL) ? s->mask[row] : (planes[0] | planes[1] | planes[2]);
+        for (int i = 0;i < s->width;i++) {
+            int x = s->x + i;
+            uint32_t bit = 0x80000000 >> i;
+            if ((mask & bit) == 0 || x < 0 || x >= dm->width) continue;
+            int colour = (planes[0] & bit) ? s->colour : 0;                         // 1 bit, its colour or 0
+            if (s->depth == 3) colour = ((planes[0] & bit) ? 1 : 0) | ((planes[1] & bit) ? 2 : 0) | ((planes[2] & bit) ? 4 : 0);
+            if (dm->isChunky) {
+                pixels[x] = colour & ((1 << dm->bitPlaneDepth)-1);
+            } else if (dm->bitPlaneDepth == 2) {                                    // 64 colours, 2 bit level for each of red green blue.
+                if (s->depth == 3) colour *= 9;
+                pixels[x] = 0;
+                for (int p = 0;p < 3;p++) pixels[x] |= (((colour >> p) & 1) * 2 + ((colour >> (p+3)) & 1)) << (p*2);
+            } else {
+                pixels[x] = colour & 7;
+            }
+        }
+    }
+}
+
+/**
+ * @brief      Convert one line of the bitplanes into packed ARGB pixels.
+ *
+ * @param      dm       Mode information
+ * @param      raster   Raster list
+ * @param[in]  count    Entries in it
+ * @param      sprites  Sprite table
+ * @param[in]  y        Line number
+ * @param      target   Where the pixels go, dm->width of them.
+ */
+static void _RNDConvertLine(DVIMODEINFO *dm,DVIRASTERENTRY *raster,int count,const DVISPRITE *sprites,int y,uint32_t *target) {
+    static uint8_t pixels[FRAME_WIDTH];
+    static uint32_t argb_chunky[DVI_PALETTE_SIZE];
+    uint32_t *palette = (dm->bitPlaneDepth == 1 || dm->cellHeight != 0) ? argb_8 : argb_64;
+    if (dm->isChunky) {                                                             // Chunky modes use the DVI palette.
+        for (int i = 0;i < (1 << dm->bitPlaneDepth);i++) argb_chunky[i] = 0xFF000000 | DVIGetPalette(i);
+        for (int i = 0;i < count && raster[i].line <= y;i++) {                      // With the raster list's changes so far.
+            if (raster[i].action == DVI_RASTER_PALETTE) argb_chunky[(raster[i].value >> 24) & 0xFF] = 0xFF000000 | raster[i].value;
+        }
+        palette = argb_chunky;
+    }
+    DVIMODEINFO lineMode = *dm;                                                     // Scroll offset for this line.
+    lineMode.yOffset = _RNDRasterOffset(dm,raster,count,y);
+    RNDPlanarToChunky(&lineMode,y,pixels);                                          // Colour indices
+    _RNDDrawSprites(dm,sprites,y,pixels);                                           // With the sprites on top.
+    for (int x = 0;x < dm->width;x++) target[x] = palette[pixels[x]];               // Then ARGB
+}
+
+#ifndef HEADLESS
+/**
+ * @brief      Take a copy of the changed lines of the display, at the vsync
+ *             point, so the app can carry on drawing while it is converted.
+ *             This is like core 1 scanning out on the hardware ; if the app is
+ *             part way through drawing a line it is picked up next frame,
+ *             because the dirty bits are taken before the lines are copied.
+ *
+ * @param      changed  Returns the lines that were copied.
+ *
+ * @return     Mode information for the copy.
+ */
+static DVIMODEINFO *_RNDSnapshot(uint32_t *changed) {
     DVIMODEINFO *dm = DVIGetModeInformation();
-    uint8_t *pr,*pg,*pb,r,g,b;
-    SDL_Rect rc;
-    rc.x = rc.y = 0;rc.w = AS_SCALEX*640+16;rc.h = AS_SCALEY*480+16;
-    SYSRectangle(&rc,0);
-    for (int y = 0;y < dm->height;y++) {
-        rc.w = AS_SCALEX * 640/dm->width;
-        rc.h = AS_SCALEY * 480/dm->height;
-        rc.y = y*rc.h+8;
-        pr = dm->bitPlane[0]+y*dm->bytesPerLine;
-        pg = dm->bitPlane[1]+y*dm->bytesPerLine;
-        pb = dm->bitPlane[2]+y*dm->bytesPerLine;
-        for (int x = 0;x < dm->width;x+= 8/dm->bitPlaneDepth) {
-            rc.x = x*rc.w+8;
-            r = *pr++;g = *pg++;b = *pb++;
-            if (dm->bitPlaneDepth == 1) {
-                for (int bt = 0;bt < 8;bt++) {
-                    uint8_t c = ((r & 0x80) >> 7)+((g & 0x80) >> 6)+((b & 0x80) >> 5);
-                    SYSRectangle(&rc,palette_8[c]);
-                    r <<= 1;g <<= 1;b <<= 1;
-                    rc.x += rc.w;
+    for (int w = 0;w < FRAME_HEIGHT/32;w++) {                                       // Take the dirty bits.
+        changed[w] = __atomic_exchange_n(&dirtyLines[w],0,__ATOMIC_ACQ_REL);
+    }
+    snapshotMode = *dm;                                                             // Copy the mode, pointing into the copy.
+    uint8_t *shown = DVIGetPageAddress(dm,dm->displayPage);                         // of the page being shown.
+    snapshotRasterCount = DVIGetRasterList(snapshotRaster);
+    for (int n = 0;n < DVI_SPRITE_ENTRIES;n++) DVIGetSprite(n,&snapshotSprites[n]);
+    for (int i = 0;i < snapshotRasterCount;i++) {                                   // Drawing is in lines after the scroll offset, so
+        if (snapshotRaster[i].action == DVI_RASTER_OFFSET) {                        // if the raster list changes it, it can be anywhere.
+            for (int w = 0;w < FRAME_HEIGHT/32;w++) changed[w] = 0xFFFFFFFF;
+        }
+    }
+    for (int p = 0;p < snapshotMode.bitPlaneCount;p++) {
+        snapshotMode.bitPlane[p] = snapshotBuffer + (shown-framebuf) + p * dm->bitPlaneSize;
+    }
+    for (int y = 0;y < snapshotMode.height;y++) {                                   // Copy the changed lines of each plane.
+        if (changed[y >> 5] & (1u << (y & 31))) {
+            uint32_t offset = DVIGetLineOffset(dm,(y + _RNDRasterOffset(dm,snapshotRaster,snapshotRasterCount,y)) % dm->height);
+            for (int p = 0;p < snapshotMode.bitPlaneCount;p++) {
+                uint8_t *plane = shown + p * dm->bitPlaneSize + offset;
+                if (plane >= framebuf && plane+snapshotMode.bytesPerLine <= framebuf+VIDEO_BYTES) {
+                    memcpy(snapshotMode.bitPlane[p]+offset,plane,snapshotMode.bytesPerLine);
                 }
-            } else {
-                for (int bt = 0;bt < 8;bt++) {
-                    uint8_t c = ((r & 0xC0) >> 6)+((g & 0xC0) >> 4)+((b & 0xC0) >> 2);
-                    SYSRectangle(&rc,palette_64[c]);
-                    r <<= 2;g <<= 2;b <<= 2;
-                    rc.x += rc.w;         
-                }       
             }
         }
-    } 
+    }
+    return &snapshotMode;
+}
+
+/**
+ * @brief      Render the display. Lines that have changed are copied, and
+ *             converted into a packed ARGB buffer, and each run of changed lines
+ *             is uploaded to the texture in one go. This can be called on a
+ *             different thread to the app.
+ *
+ * @param      texture  The texture to render it on, at least 640x480
+ * @param      rc       Returns the area of the texture actually used.
+ *
+ * @return     true if the texture was changed.
+ */
+bool RNDRender(SDL_Texture *texture,SDL_Rect *rc) {  
+    uint32_t changed[FRAME_HEIGHT/32];
+    if (!__atomic_exchange_n(&anyDirty,false,__ATOMIC_ACQ_REL)) {                   // Nothing has changed.
+        DVIMODEINFO *dm = DVIGetModeInformation();
+        rc->x = rc->y = 0;rc->w = dm->width;rc->h = dm->height;
+        return false;
+    }
+    DVIMODEINFO *dm = _RNDSnapshot(changed);
+    rc->x = rc->y = 0;rc->w = dm->width;rc->h = dm->height;
+
+    int y = 0;
+    while (y < dm->height) {
+        if ((changed[y >> 5] & (1u << (y & 31))) == 0) {                            // Skip unchanged lines.
+            y++;
+        } else {
+            SDL_Rect rcUpdate = { 0,y,dm->width,0 };                                // Convert a run of changed lines.
+            while (y < dm->height && (changed[y >> 5] & (1u << (y & 31))) != 0) {
+                _RNDConvertLine(dm,snapshotRaster,snapshotRasterCount,snapshotSprites,y,displayBuffer+y*FRAME_WIDTH);
+                y++;
+            }
+            rcUpdate.h = y-rcUpdate.y;                                              // And upload it.
+            SDL_UpdateTexture(texture,&rcUpdate,displayBuffer+rcUpdate.y*FRAME_WIDTH,FRAME_WIDTH*sizeof(uint32_t));
+        }
+    }
+    return true;
 }
+#endif
 
+/**
+ * @brief      Write the current display out as a binary PPM file, decoded from
+ *             the bitplanes.
+ *
+ * @param      fileName  File to write
+ *
+ * @return     true if written successfully.
+ */
+bool RNDWritePPM(char *fileName) {
+    static uint32_t line[FRAME_WIDTH];
+    static uint8_t rgb[FRAME_WIDTH*3];
+    static DVIRASTERENTRY raster[DVI_MAX_RASTER];
+    static DVISPRITE sprites[DVI_SPRITE_ENTRIES];
+    DVIMODEINFO *dm = DVIGetModeInformation(),shown = *dm;
+    int rasterCount = DVIGetRasterList(raster);
+    for (int n = 0;n < DVI_SPRITE_ENTRIES;n++) DVIGetSprite(n,&sprites[n]);
+    for (int p = 0;p < dm->bitPlaneCount;p++) {                                     // The page being shown.
+        shown.bitPlane[p] = DVIGetPageAddress(dm,dm->displayPage) + p * dm->bitPlaneSize;
+    }
+    FILE *f = fopen(fileName,"wb");
+    if (f == NULL) return false;
+    fprintf(f,"P6\n%d %d\n255\n",dm->width,dm->height);                            // PPM header
+    for (int y = 0;y < dm->height;y++) {
+        _RNDConvertLine(&shown,raster,rasterCount,sprites,y,line);                  // Convert to ARGB
+        for (int x = 0;x < dm->width;x++) {                                         // Then to RGB bytes.
+            rgb[x*3] = (line[x] >> 16) & 0xFF;
+            rgb[x*3+1] = (line[x] >> 8) & 0xFF;
+            rgb[x*3+2] = line[x] & 0xFF;
+        }
+        fwrite(rgb,1,dm->width*3,f);
+    }
+    return fclose(f) == 0;
+}
@@ -0,0 +1,194 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      scanout.c
+//      Purpose :   Model of core 1's scanout and PicoDVI's queues and DMA interrupt
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+#include <tmds_buffers.h>
+
+//
+//      This runs the driver's TMDS buffer scheduling (tmds_buffers.c) against a model of PicoDVI. The
+//      interrupt runs once a line, takes a buffer off the valid queue for each active line, and puts it on
+//      the free queue two interrupts later when its DMA has finished. Core 1 takes a pseudo random time
+//      to encode each line, now and then stalling long enough for the queues to run dry.
+//
+#define MODEL_BUFFERS       (3)                                                     // DVI_N_TMDS_BUFFERS
+#define MODEL_QUEUE_SIZE    (8)                                                     // Size of both queues in dvi_init()
+#define MODEL_FRAME_LINES   (525)                                                   // Lines in a 640x480 frame, with blanking.
+#define MODEL_FRAMES        (8)                                                     // Frames run in each mode.
+
+typedef struct _ModelQueue {
+    uint32_t *buffer[MODEL_QUEUE_SIZE];                                             // Buffers, oldest first
+    int line[MODEL_QUEUE_SIZE];                                                     // Display line each was queued for.
+    int count;
+} MODELQUEUE;
+
+static MODELQUEUE freeQueue,validQueue;
+static uint32_t modelBuffers[MODEL_BUFFERS];                                        // Each holds the line encoded into it.
+static uint32_t *release,*releaseNext;                                              // Being scanned out, as PicoDVI.
+static int releaseLine,releaseNextLine;
+static int scanLine;                                                                // Line the interrupt is on.
+static int queuedLine;                                                              // Display line core 1 is queueing.
+static int lateLines,badLines,overflows;
+static int coreTime;                                                                // Core 1's time since the last interrupt.
+static uint32_t seed;
+
+/**
+ * @brief      Add to the end of a queue, which is not full.
+ */
+static void _RNDQueueAdd(MODELQUEUE *q,uint32_t *buffer,int line) {
+    q->buffer[q->count] = buffer;q->line[q->count++] = line;
+}
+
+/**
+ * @brief      Take the oldest entry off a queue, which is not empty.
+ */
+static uint32_t *_RNDQueueRemove(MODELQUEUE *q,int *line) {
+    uint32_t *buffer = q->buffer[0];
+    if (line != NULL) *line = q->line[0];
+    q->count--;
+    memmove(q->buffer,q->buffer+1,q->count * sizeof(q->buffer[0]));
+    memmove(q->line,q->line+1,q->count * sizeof(q->line[0]));
+    return buffer;
+}
+
+/**
+ * @brief      One run of the DMA interrupt. A buffer that does not hold the line
+ *             it was queued for has been encoded into while waiting, which on
+ *             the hardware would show the wrong line. If the free queue is full
+ *             PicoDVI panics.
+ */
+static void _RNDScanoutLine(void) {
+    if (release != NULL) {                                                          // Finished with this one.
+        if (*release != (uint32_t)releaseLine) badLines++;
+        if (freeQueue.count == MODEL_QUEUE_SIZE) {
+            overflows++;
+        } else {
+            _RNDQueueAdd(&freeQueue,release,0);
+        }
+    }
+    release = releaseNext;releaseLine = releaseNextLine;releaseNext = NULL;
+    if (scanLine < FRAME_HEIGHT) {                                                  // Active line, scan out the next one.
+        if (validQueue.count == 0) {
+            lateLines++;                                                            // PicoDVI shows a red line.
+        } else {
+            releaseNext = _RNDQueueRemove(&validQueue,&releaseNextLine);
+            if (*releaseNext != (uint32_t)releaseNextLine) badLines++;
+        }
+    }
+    scanLine = (scanLine + 1) % MODEL_FRAME_LINES;
+}
+
+/**
+ * @brief      Core 1 working on a line. Encoding one takes a quarter to three
+ *             quarters of a line of the scanout, and once in a while core 1
+ *             stalls for a lot longer.
+ *
+ * @param[in]  isEncoding  The line is being encoded, not repeated
+ */
+static void _RNDCoreTime(bool isEncoding) {
+    seed = seed * 1103515245 + 12345;
+    if (isEncoding) coreTime += 1 + (seed >> 24) % 3;                               // In quarters of a line.
+    if (((seed >> 16) & 0xFF) == 0) coreTime += 12 * 4;
+    while (coreTime >= 4) {
+        coreTime -= 4;_RNDScanoutLine();
+    }
+}
+
+/**
+ * @brief      The model's version of taking a buffer off PicoDVI's free queue.
+ *             Waiting runs the interrupt until one comes back.
+ *
+ * @param[in]  wait  Wait for one if there are none
+ *
+ * @return     The buffer, NULL if there are none and not waiting.
+ */
+uint32_t *DVITakeReturnedBuffer(bool wait) {
+    int timeOut = MODEL_FRAME_LINES * 2;
+    while (wait && freeQueue.count == 0) {
+        if (timeOut-- == 0) exit(printf("Scanout model : waiting for a buffer that never comes back\n"));
+        _RNDScanoutLine();coreTime = 0;                                             // Core 1 carries on from the interrupt.
+    }
+    return (freeQueue.count == 0) ? NULL : _RNDQueueRemove(&freeQueue,NULL);
+}
+
+/**
+ * @brief      The model's version of putting a buffer on PicoDVI's valid queue,
+ *             running the interrupt until there is room.
+ *
+ * @param      buffer  The buffer
+ */
+void DVISendBuffer(uint32_t *buffer) {
+    while (validQueue.count == MODEL_QUEUE_SIZE) {
+        _RNDScanoutLine();coreTime = 0;
+    }
+    _RNDQueueAdd(&validQueue,buffer,queuedLine);
+}
+
+/**
+ * @brief      Run core 1's scanout loop for a few frames in a mode, encoding a
+ *             line only when it is not the same as the previous output line's.
+ *
+ * @param      lineMap  Display line for each output line
+ *
+ * @return     Encodes per frame.
+ */
+static int _RNDModelFrames(const uint16_t *lineMap) {
+    memset(&freeQueue,0,sizeof(freeQueue));memset(&validQueue,0,sizeof(validQueue));
+    release = releaseNext = NULL;
+    scanLine = FRAME_HEIGHT;                                                        // Start in the vertical blank.
+    lateLines = badLines = overflows = coreTime = 0;seed = 42;
+    DVIResetTMDSBuffers();
+    for (int i = 0;i < MODEL_BUFFERS;i++) _RNDQueueAdd(&freeQueue,&modelBuffers[i],0);
+    int encodes = 0;
+    uint32_t *tmdsbuf = NULL;
+    for (int frame = 0;frame < MODEL_FRAMES;frame++) {
+        for (int y = 0;y < FRAME_HEIGHT;y++) {
+            queuedLine = lineMap[y];
+            bool isEncoding = (tmdsbuf == NULL || y == 0 || lineMap[y] != lineMap[y-1]);
+            if (isEncoding) {                                                       // New line, encode it.
+                tmdsbuf = DVIGetTMDSBuffer();
+                *tmdsbuf = queuedLine;encodes++;
+            }
+            _RNDCoreTime(isEncoding);
+            DVIQueueTMDSBuffer(tmdsbuf);
+        }
+    }
+    return encodes / MODEL_FRAMES;
+}
+
+/**
+ * @brief      Model the hardware scanout in every mode. This builds the same
+ *             line maps as DVISetMode(), checks each one starts at the top,
+ *             finishes at the bottom and shows every line once or more in
+ *             order, then runs the buffer scheduling against the model of
+ *             PicoDVI, checking no buffer is encoded into while queued and
+ *             the free queue never fills.
+ */
+void RNDModelScanout(void) {
+    static uint16_t lineMap[FRAME_HEIGHT];
+    printf("\n%-6s %12s %12s %10s %10s %10s\n","Mode","Out lines","Encodes","Late","Bad","Overflows");
+    for (int mode = 0;mode < DVI_MODE_COUNT;mode++) {
+        const DVIMODEDESCRIPTOR *md = DVIGetModeDescriptor(mode);
+        DVIBuildLineMap(md->lineRepeat,lineMap);
+        bool isValid = (lineMap[0] == 0 && lineMap[FRAME_HEIGHT-1] == md->height-1);
+        for (int y = 0;y < FRAME_HEIGHT;y++) {
+            if (y > 0 && lineMap[y] != lineMap[y-1] && lineMap[y] != lineMap[y-1]+1) isValid = false;
+            if (lineMap[y] != DVIGetSourceLine(md->lineRepeat,y)) isValid = false;
+        }
+        int planeLines = (md->cellHeight != 0) ? md->height / md->cellHeight : md->height;
+        int lineBytes = md->width * md->bitPlaneDepth / 8;                          // Bytes in a line, or in the
+        if (md->cellHeight != 0) lineBytes /= 8;                                    // text modes a row of 8 pixel cells.
+        if (lineBytes * planeLines * md->bitPlaneCount > VIDEO_BYTES) isValid = false;
+        if (!isValid) printf("Mode %d has a bad line map or does not fit in framebuf\n",mode);
+        int encodes = _RNDModelFrames(lineMap);
+        printf("%-6d %12d %12d %10d %10d %10d\n",mode,FRAME_HEIGHT,encodes,lateLines,badLines,overflows);
+        if (badLines != 0 || overflows != 0) printf("Mode %d : TMDS buffer scheduling is wrong\n",mode);
+    }
+}
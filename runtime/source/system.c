@@ -11,15 +11,14 @@
 
 #include <runtime.h>
 
+#ifndef HEADLESS
+
 static SDL_Window *mainWindow = NULL;
-static SDL_Surface *mainSurface = NULL;
+static SDL_Renderer *mainRenderer = NULL;
+static SDL_Texture *mainTexture = NULL;
 
 static int startTime = 0,endTime = 0,frameCount = 0;
 
-#define RED(x) ((((x) >> 8) & 0xF) * 17)
-#define GREEN(x) ((((x) >> 4) & 0xF) * 17)
-#define BLUE(x) ((((x) >> 0) & 0xF) * 17)
-
 /**
  * @brief      Open the main window and start everything off
  *
@@ -31,14 +30,25 @@ void SYSOpen(bool muteSound) {
     if (SDL_Init(SDL_INIT_VIDEO|SDL_INIT_AUDIO|SDL_INIT_GAMECONTROLLER) < 0)    {   // Try to initialise SDL Video and Audio
         exit(printf( "SDL could not initialize! SDL_Error: %s\n", SDL_GetError()));
     }
+    RUNTIMEOPTIONS *opt = SYSGetOptions();
     mainWindow = SDL_CreateWindow("RP2350PC Runtime System",                        // Try to create a window
                             SDL_WINDOWPOS_UNDEFINED,SDL_WINDOWPOS_UNDEFINED, 
-                            640*AS_SCALEX+16,480*AS_SCALEY+16, SDL_WINDOW_SHOWN );
+                            FRAME_WIDTH*opt->scaleX+16,FRAME_HEIGHT*opt->scaleY+16,
+                            SDL_WINDOW_SHOWN | (opt->letterbox ? SDL_WINDOW_RESIZABLE : 0));
     if (mainWindow == NULL) {
         exit(printf( "Window could not be created! SDL_Error: %s\n", SDL_GetError() ));
     }
 
-    mainSurface = SDL_GetWindowSurface(mainWindow);                                 // Get a surface to draw on.
+    mainRenderer = SDL_CreateRenderer(mainWindow,-1,0);                             // Renderer, and a texture the display is copied to.
+    if (mainRenderer == NULL) {
+        exit(printf( "Renderer could not be created! SDL_Error: %s\n", SDL_GetError() ));
+    }
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY,"0");                                 // Scale with nearest pixel, not blurred.
+    mainTexture = SDL_CreateTexture(mainRenderer,SDL_PIXELFORMAT_ARGB8888,
+                                    SDL_TEXTUREACCESS_STREAMING,FRAME_WIDTH,FRAME_HEIGHT);
+    if (mainTexture == NULL) {
+        exit(printf( "Texture could not be created! SDL_Error: %s\n", SDL_GetError() ));
+    }
 
     // CTLFindControllers();                                                        // Have to be done after SDL Initialisation.
     // SOUNDOpen();
@@ -50,7 +60,31 @@ void SYSOpen(bool muteSound) {
 }
 
 
+/**
+ * @brief      Work out where the display goes in the window. Normally this is
+ *             the scale given, with a border. In letterbox mode it is the
+ *             largest whole number scale, the same in both directions, that fits
+ *             the window, centred.
+ *
+ * @param      rc    Returns the display rectangle.
+ */
+static void _SYSGetDisplayRect(SDL_Rect *rc) {
+    RUNTIMEOPTIONS *opt = SYSGetOptions();
+    if (opt->letterbox) {
+        int w,h;
+        SDL_GetRendererOutputSize(mainRenderer,&w,&h);
+        int scale = (w / FRAME_WIDTH < h / FRAME_HEIGHT) ? w / FRAME_WIDTH : h / FRAME_HEIGHT;
+        if (scale < 1) scale = 1;                                                   // Too small, it is clipped.
+        rc->w = FRAME_WIDTH*scale;rc->h = FRAME_HEIGHT*scale;
+        rc->x = (w-rc->w)/2;rc->y = (h-rc->h)/2;
+    } else {
+        rc->x = rc->y = 8;                                                          // Leaving a border.
+        rc->w = FRAME_WIDTH*opt->scaleX;rc->h = FRAME_HEIGHT*opt->scaleY;
+    }
+}
+
 static int isRunning = -1;                                                          // Is app running
+static bool needsPresent = true;                                                    // Window needs repainting even if display unchanged.
 
 /**
  * @brief      Check the SDL2 message queue, update mouse and keyboard, update display.
@@ -76,14 +110,24 @@ int SYSPollUpdate(void) {
             // if (event.wheel.type == SDL_MOUSEWHEEL_FLIPPED) dy = -dy;
             // MSEUpdateScrollWheel(dy);
         }
+        if (event.type == SDL_WINDOWEVENT) {                                        // Window exposed, resized etc. so repaint.
+            needsPresent = true;
+        }
         if (event.type == SDL_QUIT) {                                               // Exit on Alt+F4 etc.
             isRunning = 0;
         }
     }
     frameCount++;
-    SYSRectangle(NULL,0x008);
-    RNDRender(mainSurface);
-    SDL_UpdateWindowSurface(mainWindow);                                            // And update the main window.  
+    SDL_Rect rcSource,rcTarget;
+    if (RNDRender(mainTexture,&rcSource)) needsPresent = true;                      // Convert changed lines to the texture.
+    __atomic_add_fetch(&dvi_frameCount,1,__ATOMIC_RELEASE);                         // Displayed, so vertical sync.
+    if (!needsPresent) return isRunning;                                            // Nothing has changed, so nothing to do.
+    needsPresent = false;
+    _SYSGetDisplayRect(&rcTarget);                                                  // Where it goes in the window.
+    SDL_SetRenderDrawColor(mainRenderer,0,0,0,255);                                 // Clear the border
+    SDL_RenderClear(mainRenderer);
+    SDL_RenderCopy(mainRenderer,mainTexture,&rcSource,&rcTarget);                   // Scale the display to the window in one copy
+    SDL_RenderPresent(mainRenderer);                                                // And update the main window.  
     return isRunning;
 }
 
@@ -92,31 +136,13 @@ int SYSPollUpdate(void) {
  */
 void SYSClose(void) {
     endTime = COMClock();
-    SDL_DestroyWindow(mainWindow);                                                  // Destroy working window
+    SDL_DestroyTexture(mainTexture);                                                // Destroy texture, renderer and working window
+    SDL_DestroyRenderer(mainRenderer);
+    SDL_DestroyWindow(mainWindow);
     // SOUNDStop();
     // SDL_CloseAudio();                                                            // Shut audio up.
     SDL_Quit();                                                                     // Exit SDL.
     printf("Frame Rate %.2f\n",frameCount/((endTime-startTime)/1000.0));
 }
 
-
-/**
- * @brief      Return the drawing surface
- *
- * @return     SDL Surface pointer
- */
-SDL_Surface *SYSGetSurface(void) {
-    return mainSurface;
-}
-
-/**
- * @brief      Draw arectangle on the working surface
- *
- * @param      rc      Rectangle dimensions
- * @param[in]  colour  Fill Colour
- */
-void SYSRectangle(SDL_Rect *rc,int colour) {
-    SDL_FillRect(mainSurface,rc,SDL_MapRGB(mainSurface->format,RED(colour),GREEN(colour),BLUE(colour)));
-}
-
-
+#endif
@@ -0,0 +1,153 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      timing.c
+//      Purpose :   High resolution clock and frame timing statistics.
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+
+//
+//      One of these is recorded for every frame, all times in microseconds. The frame time is from the start
+//      of one frame to the start of the next, the render time is the time taken handling events and drawing,
+//      and the app time is the time between the end of one render and the start of the next.
+//
+typedef struct _frameSample {
+    float frameTime,renderTime,appTime;
+} FRAMESAMPLE;
+
+static FRAMESAMPLE *samples = NULL;                                                 // Samples, grown as needed.
+static int sampleCount = 0,sampleSize = 0;
+
+static uint64_t frameStart = 0,lastFrameStart = 0,lastRenderEnd = 0;                // Times of the current and last frames.
+static FILE *logFile = NULL;                                                        // Per frame log, if required.
+
+/**
+ * @brief      High resolution clock.
+ *
+ * @return     Microseconds since the first call.
+ */
+uint64_t SYSClockMicroseconds(void) {
+    #ifdef HEADLESS
+    static uint64_t startTime = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    #else
+    static uint64_t startTime = 0;
+    static double scale = 0;
+    if (scale == 0) scale = 1000000.0 / SDL_GetPerformanceFrequency();              // Performance counter ticks to microseconds.
+    uint64_t now = (uint64_t)(SDL_GetPerformanceCounter() * scale);
+    #endif
+    if (startTime == 0) startTime = now;
+    return now - startTime;
+}
+
+/**
+ * @brief      Start timing frames.
+ *
+ * @param      logFileName  File to log each frame's times to, or NULL.
+ */
+void SYSTimingStart(char *logFileName) {
+    lastFrameStart = lastRenderEnd = SYSClockMicroseconds();
+    if (logFileName != NULL) {
+        logFile = fopen(logFileName,"w");
+        if (logFile == NULL) exit(printf("Cannot create %s\n",logFileName));
+        fprintf(logFile,"frame,frame_us,render_us,app_us\n");
+    }
+}
+
+/**
+ * @brief      Called when a frame's render starts.
+ */
+void SYSTimingBeginFrame(void) {
+    frameStart = SYSClockMicroseconds();
+}
+
+/**
+ * @brief      Called when a frame's render ends, records the frame's times.
+ */
+void SYSTimingEndFrame(void) {
+    uint64_t now = SYSClockMicroseconds();
+    if (sampleCount == sampleSize) {                                                // Make more space.
+        sampleSize = (sampleSize == 0) ? 4096 : sampleSize * 2;
+        samples = realloc(samples,sampleSize * sizeof(FRAMESAMPLE));
+        if (samples == NULL) exit(printf("Out of memory for frame timing\n"));
+    }
+    FRAMESAMPLE *s = &samples[sampleCount++];
+    s->frameTime = frameStart - lastFrameStart;
+    s->renderTime = now - frameStart;
+    s->appTime = frameStart - lastRenderEnd;
+    if (logFile != NULL) {
+        fprintf(logFile,"%d,%.0f,%.0f,%.0f\n",sampleCount-1,s->frameTime,s->renderTime,s->appTime);
+    }
+    lastFrameStart = frameStart;lastRenderEnd = now;
+}
+
+/**
+ * @brief      Sort comparison for floats.
+ */
+static int _SYSCompareFloat(const void *a,const void *b) {
+    float fa = *(const float *)a,fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+/**
+ * @brief      Print min/median/p99/max for one of the sample fields.
+ *
+ * @param      name    Name of the field
+ * @param[in]  offset  Offset of the field in FRAMESAMPLE
+ * @param      work    Work space, sampleCount floats.
+ */
+static void _SYSPrintStatistics(char *name,size_t offset,float *work) {
+    for (int i = 0;i < sampleCount;i++) work[i] = *(float *)((uint8_t *)&samples[i]+offset);
+    qsort(work,sampleCount,sizeof(float),_SYSCompareFloat);
+    printf("%-8s %9.2f %9.2f %9.2f %9.2f\n",name,work[0]/1000.0,work[sampleCount/2]/1000.0,
+                                    work[(sampleCount-1)*99/100]/1000.0,work[sampleCount-1]/1000.0);
+}
+
+/**
+ * @brief      Print the frame timing statistics, and a histogram of frame
+ *             times, so stutter which an average would hide shows up.
+ *
+ * @param[in]  frameRate  The target frame rate.
+ */
+void SYSTimingReport(double frameRate) {
+    if (logFile != NULL) fclose(logFile);
+    logFile = NULL;
+    if (sampleCount == 0) return;
+    float *work = malloc(sampleCount * sizeof(float));
+    if (work == NULL) return;
+    printf("%d frames, target %.2fms\n",sampleCount,1000.0/frameRate);
+    printf("%-8s %9s %9s %9s %9s\n","(ms)","min","median","p99","max");
+    _SYSPrintStatistics("Frame",offsetof(FRAMESAMPLE,frameTime),work);
+    _SYSPrintStatistics("Render",offsetof(FRAMESAMPLE,renderTime),work);
+    _SYSPrintStatistics("App",offsetof(FRAMESAMPLE,appTime),work);
+    free(work);
+
+    #define BUCKETS     (16)                                                        // Histogram of frame times, 2ms buckets
+    #define BUCKET_SIZE (2000)
+    int buckets[BUCKETS+1] = { 0 },largest = 1;
+    for (int i = 0;i < sampleCount;i++) {
+        int b = (int)(samples[i].frameTime / BUCKET_SIZE);
+        if (b > BUCKETS) b = BUCKETS;                                               // Last one is overflow.
+        buckets[b]++;
+        if (buckets[b] > largest) largest = buckets[b];
+    }
+    for (int b = 0;b <= BUCKETS;b++) {
+        if (buckets[b] == 0) continue;
+        char label[16];
+        if (b < BUCKETS) {
+            snprintf(label,sizeof(label),"%2d-%2dms",b*BUCKET_SIZE/1000,(b+1)*BUCKET_SIZE/1000);
+        } else {
+            snprintf(label,sizeof(label),">=%2dms",BUCKETS*BUCKET_SIZE/1000);
+        }
+        printf("%-8s %7d ",label,buckets[b]);
+        for (int i = 0;i < (buckets[b]*50+largest-1)/largest;i++) printf("#");
+        printf("\n");
+    }
+}
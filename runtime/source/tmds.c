@@ -0,0 +1,217 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      tmds.c
+//      Purpose :   Check and benchmark the TMDS encoders on the host
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+#include <tmds_encode_reference.h>
+
+//
+//      Encoders have the same interface as tmds_encode_custom_1bpp/2bpp. New variants go in the table
+//      below, which is checked against the DVI specification encoder (tmds_encode_symbol()) and timed.
+//
+typedef void (*TMDSENCODER)(const uint32_t *pixbuf,uint32_t *symbuf,size_t n_pix);
+
+static uint32_t byteTable1bpp[256][4],byteTable2bpp[256][4];                        // 8 input bits -> 4 output words.
+
+/**
+ * @brief      Build a table indexed by a whole input byte, using the reference
+ *             encoder so the bit order is the same.
+ *
+ * @param      encode  Reference encoder
+ * @param      table   Table to build
+ */
+static void _RNDBuildByteTable(TMDSENCODER encode,uint32_t table[256][4]) {
+    uint32_t symbols[16];
+    for (uint32_t b = 0;b < 256;b++) {
+        encode(&b,symbols,32);                                                      // Byte 0 of the word is the first 4 words out.
+        memcpy(table[b],symbols,sizeof(table[b]));
+    }
+}
+
+/**
+ * @brief      Table driven variant, one lookup per input byte rather than per
+ *             4 bits. Assumes a little endian host, as the RP2350 is.
+ */
+static inline void _RNDByteEncode(uint32_t table[256][4],const uint32_t *pixbuf,uint32_t *symbuf,size_t n_pix) {
+    const uint8_t *pixels = (const uint8_t *)pixbuf;
+    uint32_t *end = symbuf + n_pix / 2;
+    while (symbuf < end) {
+        for (int i = 0;i < 4;i++) {
+            memcpy(symbuf,table[*pixels++],16);symbuf += 4;
+        }
+    }
+}
+
+static void _RNDByteEncode1bpp(const uint32_t *pixbuf,uint32_t *symbuf,size_t n_pix) {
+    _RNDByteEncode(byteTable1bpp,pixbuf,symbuf,n_pix);
+}
+
+static void _RNDByteEncode2bpp(const uint32_t *pixbuf,uint32_t *symbuf,size_t n_pix) {
+    _RNDByteEncode(byteTable2bpp,pixbuf,symbuf,n_pix);
+}
+
+static struct {
+    const char *name;
+    TMDSENCODER encode1bpp,encode2bpp;
+} encoders[] = {
+    { "Reference",  tmds_encode_reference_1bpp, tmds_encode_reference_2bpp },
+    { "ByteTable",  _RNDByteEncode1bpp,         _RNDByteEncode2bpp }
+};
+
+#define ENCODER_COUNT   ((int)(sizeof(encoders)/sizeof(encoders[0])))
+
+/**
+ * @brief      Get a pixel from the input line in the order the encoders use.
+ *
+ * @param      line   Input bytes
+ * @param[in]  x      Pixel number
+ * @param[in]  depth  Bits per pixel (1 or 2)
+ *
+ * @return     Pixel value
+ */
+static int _RNDGetPixel(const uint8_t *line,int x,int depth) {
+    if (depth == 1) {
+        #if DVI_1BPP_BIT_REVERSE
+        return (line[x/8] >> (7-x%8)) & 1;
+        #else
+        return (line[x/8] >> (x%8)) & 1;
+        #endif
+    }
+    #if DVI_1BPP_BIT_REVERSE
+    static const int shift[4] = { 6,4,2,0 };
+    #else
+    static const int shift[4] = { 2,0,6,4 };                                        // Lower 4 bits first, upper pixel of each first.
+    #endif
+    return (line[x/4] >> shift[x%4]) & 3;
+}
+
+/**
+ * @brief      Build the golden symbol stream for a line using the specification
+ *             encoder. For 1bpp black and white are 0x00/0xFF on even pixels
+ *             and 0x01/0xFE on odd ones, which brings the disparity back to
+ *             zero every pair. For 2bpp each pixel is a pair of values at one
+ *             of four levels, also balanced.
+ *
+ * @param      line    Input bytes
+ * @param      golden  Output symbols
+ * @param[in]  n_pix   Output pixel count
+ * @param[in]  depth   Bits per pixel (1 or 2)
+ */
+static void _RNDGoldenLine(const uint8_t *line,uint32_t *golden,int n_pix,int depth) {
+    static const uint8_t levels[4][2] = { { 0x05,0x04 },{ 0x50,0x51 },{ 0xAF,0xAE },{ 0xFA,0xFB } };
+    int balance = 0;
+    for (int w = 0;w < n_pix/2;w++) {
+        uint8_t d0,d1;
+        if (depth == 1) {
+            d0 = _RNDGetPixel(line,w*2,1) ? 0xFF : 0x00;
+            d1 = _RNDGetPixel(line,w*2+1,1) ? 0xFE : 0x01;
+        } else {
+            int level = _RNDGetPixel(line,w,2);
+            d0 = levels[level][0];d1 = levels[level][1];
+        }
+        int s0 = tmds_encode_symbol(d0,&balance);
+        int s1 = tmds_encode_symbol(d1,&balance);
+        golden[w] = s0 | (s1 << 10);
+    }
+}
+
+/**
+ * @brief      Check every encoder against the golden stream for a number of
+ *             lines : all byte values in every position, solid and
+ *             alternating lines, and random ones.
+ *
+ * @param[in]  depth  Bits per pixel (1 or 2)
+ *
+ * @return     Number of encoders that failed
+ */
+static int _RNDCheckEncoders(int depth) {
+    static uint32_t input[FRAME_WIDTH/32],golden[FRAME_WIDTH/2],result[FRAME_WIDTH/2];
+    uint8_t *line = (uint8_t *)input;
+    const int bytes = FRAME_WIDTH / 8;                                              // 640 pixels at 1bpp, 320 at 2bpp.
+    int failed = 0;
+    for (int c = 0;c < ENCODER_COUNT;c++) {
+        TMDSENCODER encode = (depth == 1) ? encoders[c].encode1bpp : encoders[c].encode2bpp;
+        for (int test = 0;test < 256+4+64;test++) {
+            for (int i = 0;i < bytes;i++) {
+                if (test < 256) line[i] = (test + i * 37) & 0xFF;                   // Every byte value in every position.
+                else if (test < 260) line[i] = (uint8_t []) { 0x00,0xFF,0x55,0xAA }[test-256];
+                else line[i] = rand();
+            }
+            _RNDGoldenLine(line,golden,FRAME_WIDTH,depth);
+            memset(result,0,sizeof(result));
+            encode(input,result,FRAME_WIDTH);
+            if (memcmp(golden,result,sizeof(result)) != 0) {
+                printf("%s %dbpp encoder does not match the specification, test %d\n",encoders[c].name,depth,test);
+                failed++;
+                break;
+            }
+        }
+    }
+    return failed;
+}
+
+/**
+ * @brief      Check the palette encoders used by the chunky modes, with a
+ *             random palette, against the specification encoder run over the
+ *             whole line.
+ *
+ * @param[in]  depth  Bits per pixel (4 or 8)
+ *
+ * @return     Number of encoders that failed
+ */
+static int _RNDCheckPaletteEncoder(int depth) {
+    static uint8_t line[FRAME_WIDTH/2],levels[256];
+    static uint32_t palette[256],golden[FRAME_WIDTH/2],result[FRAME_WIDTH/2];
+    for (int i = 0;i < 256;i++) {
+        levels[i] = rand();palette[i] = tmds_encode_balanced_pair(levels[i]);
+    }
+    for (int i = 0;i < FRAME_WIDTH/2;i++) line[i] = rand();
+    int balance = 0;
+    for (int x = 0;x < FRAME_WIDTH/2;x++) {                                         // Each pixel is the level then the level ^ 1
+        int pixel = (depth == 8) ? line[x] : (line[x/2] >> ((x & 1) ? 0 : 4)) & 0x0F;
+        int s0 = tmds_encode_symbol(levels[pixel],&balance);
+        int s1 = tmds_encode_symbol(levels[pixel] ^ 1,&balance);
+        golden[x] = s0 | (s1 << 10);
+    }
+    (depth == 8 ? tmds_encode_palette_8bpp : tmds_encode_palette_4bpp)(line,result,FRAME_WIDTH,palette);
+    if (memcmp(golden,result,sizeof(result)) == 0) return 0;
+    printf("%dbpp palette encoder does not match the specification\n",depth);
+    return 1;
+}
+
+/**
+ * @brief      Check the TMDS encoders produce exactly the same symbols as the
+ *             specification encoder, then time them.
+ */
+void RNDBenchmarkTMDS(void) {
+    static uint32_t input[FRAME_WIDTH/32],result[FRAME_WIDTH/2];
+    const int repeats = 20000;
+    _RNDBuildByteTable(tmds_encode_reference_1bpp,byteTable1bpp);
+    _RNDBuildByteTable(tmds_encode_reference_2bpp,byteTable2bpp);
+    int failed = _RNDCheckEncoders(1) + _RNDCheckEncoders(2) + _RNDCheckPaletteEncoder(4) + _RNDCheckPaletteEncoder(8);
+    printf("TMDS encoders %s the specification encoder\n",failed == 0 ? "match" : "do not match");
+
+    for (int i = 0;i < FRAME_WIDTH/32;i++) input[i] = rand() ^ (rand() << 16);
+    printf("%-6s %-10s %10s %8s\n","Depth","Encoder","Mpixels/s","Speedup");
+    for (int depth = 1;depth <= 2;depth++) {
+        double baseTime = 0;
+        for (int c = 0;c < ENCODER_COUNT;c++) {
+            TMDSENCODER encode = (depth == 1) ? encoders[c].encode1bpp : encoders[c].encode2bpp;
+            clock_t start = clock();                                                // Time one colour component of a line.
+            for (int r = 0;r < repeats;r++) {
+                encode(input,result,FRAME_WIDTH);
+            }
+            double elapsed = (double)(clock()-start) / CLOCKS_PER_SEC + 1e-9;
+            if (c == 0) baseTime = elapsed;
+            printf("%-6d %-10s %10.1f %7.1fx\n",depth,encoders[c].name,
+                                    (double)repeats*FRAME_WIDTH/elapsed/1e6,baseTime/elapsed);
+        }
+    }
+}
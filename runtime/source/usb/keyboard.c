@@ -11,6 +11,9 @@
 
 #include "runtime.h"
 #include "usb_keycodes.h"
+
+#ifndef HEADLESS
+
 /**
  * @brief      Convert an SDL event to one suitable for the keyboard system
  *
@@ -52,5 +55,7 @@ void KBDProcessEvent(int scanCode,int modifiers,bool isDown) {
     report.type = 'K';
     report.vid = report.pid = 0;
     report.data = packet;report.length = 8;
-    USBDispatchPacket(&report);
+    USBQueuePacket(&report);
 }
+
+#endif
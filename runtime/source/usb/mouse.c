@@ -11,6 +11,8 @@
 
 #include "runtime.h"
 
+#ifndef HEADLESS
+
 static bool hasMousePacket = false;
 static int lastX,lastY;
 
@@ -38,8 +40,10 @@ void SYSUpdateMouse(void) {
         report.vid = report.pid = 0;
         report.data = packet;report.length = 9;
 
-        USBDispatchPacket(&report);
+        USBQueuePacket(&report);
     }
     lastX = x;lastY = y;                                                            // Save mouse absolute and mark lastx/y as now valid.
     hasMousePacket = true;
 }
+
+#endif
@@ -0,0 +1,147 @@
+// *******************************************************************************************
+// *******************************************************************************************
+//
+//      Name :      replay.c
+//      Purpose :   Record and replay USB input reports.
+//      Date :      17th October 2026
+//      Author :    Paul Robson (paul@robsons.org.uk)
+//
+// *******************************************************************************************
+// *******************************************************************************************
+
+#include <runtime.h>
+
+//
+//      The file is the magic string and a version byte, followed by one record per report :
+//
+//          time        8 bytes, microseconds on the app's clock, low first
+//          type        1 byte
+//          vid,pid     2 bytes each, low first
+//          length      1 byte
+//          data        length bytes
+//
+//      Reports are recorded as they are dispatched to the handlers, and replayed at the first yield at or after
+//      the recorded time. With the virtual clock this is the same point in the program as when recorded.
+//
+#define INPUT_MAGIC     "RPIN"
+#define INPUT_VERSION   (1)
+
+static FILE *recordFile = NULL;                                                     // Recording to this
+static FILE *replayFile = NULL;                                                     // Replaying from this
+
+static bool hasNext = false;                                                        // Next report to replay, read ahead.
+static uint64_t nextTime;
+static USBREPORT nextReport;
+static uint8_t nextData[256];
+
+/**
+ * @brief      Write a little endian number.
+ *
+ * @param[in]  value  Value
+ * @param[in]  bytes  Number of bytes
+ */
+static void _USBWriteNumber(uint64_t value,int bytes) {
+    for (int i = 0;i < bytes;i++) fputc((value >> (i*8)) & 0xFF,recordFile);
+}
+
+/**
+ * @brief      Read a little endian number.
+ *
+ * @param[in]  bytes  Number of bytes
+ *
+ * @return     The value
+ */
+static uint64_t _USBReadNumber(int bytes) {
+    uint64_t value = 0;
+    for (int i = 0;i < bytes;i++) value |= ((uint64_t)(fgetc(replayFile) & 0xFF)) << (i*8);
+    return value;
+}
+
+/**
+ * @brief      Read the next report to replay into nextReport.
+ */
+static void _USBReadNext(void) {
+    hasNext = false;
+    nextTime = _USBReadNumber(8);
+    nextReport.type = _USBReadNumber(1);
+    nextReport.vid = _USBReadNumber(2);
+    nextReport.pid = _USBReadNumber(2);
+    nextReport.length = _USBReadNumber(1);
+    nextReport.data = nextData;
+    if (fread(nextData,1,nextReport.length,replayFile) != nextReport.length) return; // End of file.
+    hasNext = !feof(replayFile);
+}
+
+/**
+ * @brief      Start recording input
+ *
+ * @param      fileName  File to record to.
+ */
+void USBStartInputRecording(char *fileName) {
+    recordFile = fopen(fileName,"wb");
+    if (recordFile == NULL) exit(printf("Cannot create %s\n",fileName));
+    fwrite(INPUT_MAGIC,1,4,recordFile);
+    fputc(INPUT_VERSION,recordFile);
+}
+
+/**
+ * @brief      Record a report, if recording, called as it is dispatched.
+ *
+ * @param      r     Report
+ */
+void USBRecordInput(USBREPORT *r) {
+    if (recordFile == NULL || r->length > 255) return;
+    _USBWriteNumber(SYSAppClockMicroseconds(),8);
+    _USBWriteNumber(r->type,1);
+    _USBWriteNumber(r->vid,2);
+    _USBWriteNumber(r->pid,2);
+    _USBWriteNumber(r->length,1);
+    fwrite(r->data,1,r->length,recordFile);
+}
+
+/**
+ * @brief      Start replaying input. Live input is ignored from now on.
+ *
+ * @param      fileName  File to replay.
+ */
+void USBStartInputReplay(char *fileName) {
+    replayFile = fopen(fileName,"rb");
+    if (replayFile == NULL) exit(printf("Cannot open %s\n",fileName));
+    uint8_t header[5];
+    if (fread(header,1,5,replayFile) != 5 || memcmp(header,INPUT_MAGIC,4) != 0 || header[4] != INPUT_VERSION) {
+        exit(printf("%s is not an input recording\n",fileName));
+    }
+    _USBReadNext();
+}
+
+/**
+ * @brief      Is input being replayed ?
+ *
+ * @return     true if replaying, so live input should be ignored.
+ */
+bool USBIsReplayingInput(void) {
+    return replayFile != NULL;
+}
+
+/**
+ * @brief      Dispatch any replayed reports that are due. Called on the app's
+ *             thread when it yields.
+ */
+void USBReplayInput(void) {
+    if (replayFile == NULL) return;
+    uint64_t now = SYSAppClockMicroseconds();
+    while (hasNext && nextTime <= now) {
+        USBRecordInput(&nextReport);                                                // So it can be recorded again.
+        USBDispatchPacket(&nextReport);
+        _USBReadNext();
+    }
+}
+
+/**
+ * @brief      Finish recording and replaying input.
+ */
+void USBEndInputRecording(void) {
+    if (recordFile != NULL) fclose(recordFile);
+    if (replayFile != NULL) fclose(replayFile);
+    recordFile = replayFile = NULL;
+}
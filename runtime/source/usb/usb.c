@@ -14,6 +14,30 @@
 static int handlerCount = 0;
 static USBHANDLERFUNCTION handlers[8];
 
+//
+//      Packets from the SDL event loop are queued, and dispatched on the app's thread when it yields. When the
+//      display runs on its own thread (--threaded) these are different threads.
+//
+#define QUEUE_SIZE          (64)                                                    // Packets in the queue.
+#define MAX_PACKET_SIZE     (16)                                                    // Largest packet (keyboard 8, mouse 9)
+
+typedef struct _queuedReport {
+    USBREPORT report;
+    uint8_t data[MAX_PACKET_SIZE];
+} QUEUEDREPORT;
+
+static QUEUEDREPORT queue[QUEUE_SIZE];
+static int queueHead = 0,queueTail = 0;                                             // Add at head, remove at tail.
+
+#ifndef HEADLESS
+static SDL_SpinLock queueLock = 0;
+#define LOCKQUEUE()     SDL_AtomicLock(&queueLock)
+#define UNLOCKQUEUE()   SDL_AtomicUnlock(&queueLock)
+#else
+#define LOCKQUEUE()     {}
+#define UNLOCKQUEUE()   {}
+#endif
+
 /**
  * @brief      Initialise the USB system.
  */
@@ -52,3 +76,44 @@ void USBDispatchPacket(USBREPORT *r) {
         }
     }
 }
+
+/**
+ * @brief      Queue a packet to be dispatched when the app next yields. The
+ *             data is copied. If the queue is full the packet is lost, as it
+ *             would be on the real hardware.
+ *
+ * @param      r     Packet to queue.
+ */
+void USBQueuePacket(USBREPORT *r) {
+    if (USBIsReplayingInput()) return;                                              // Replaying, so live input is ignored.
+    LOCKQUEUE();
+    int next = (queueHead+1) % QUEUE_SIZE;
+    if (next != queueTail && r->length <= MAX_PACKET_SIZE) {                        // Space, and it will fit.
+        QUEUEDREPORT *q = &queue[queueHead];
+        q->report = *r;
+        memcpy(q->data,r->data,r->length);
+        q->report.data = q->data;
+        queueHead = next;
+    }
+    UNLOCKQUEUE();
+}
+
+/**
+ * @brief      Dispatch all the queued packets. Called on the app's thread.
+ */
+void USBProcessQueue(void) {
+    static QUEUEDREPORT pending[QUEUE_SIZE];
+    int count = 0;
+    LOCKQUEUE();                                                                    // Take everything out of the queue
+    while (queueTail != queueHead) {
+        pending[count] = queue[queueTail];
+        pending[count].report.data = pending[count].data;
+        count++;
+        queueTail = (queueTail+1) % QUEUE_SIZE;
+    }
+    UNLOCKQUEUE();
+    for (int i = 0;i < count;i++) {                                                 // And dispatch it without the lock.
+        USBRecordInput(&pending[i].report);
+        USBDispatchPacket(&pending[i].report);
+    }
+}